@@ -4,6 +4,7 @@
 from flask import Flask
 from flask import jsonify
 from flask import request
+from flask import Response
 
 from urllib.request import urlopen
 import lxml.etree as ET
@@ -86,6 +87,27 @@ def getNexusData(instrument, cycles, runs, fields):
     fieldData = nexusInteraction.fieldData(instrument, cycles, runs, fields)
     return jsonify(fieldData)
 
+# Get a level of detail tile of a log field. At level 0 one tile spans the
+# log, and each level halves the tiles; logs short enough to send whole come
+# back as from getNexusData
+
+
+@app.route('/getLogTile/<instrument>/<cycles>/<runs>/<field>/<level>/<tile>')
+def getLogTile(instrument, cycles, runs, field, level, tile):
+    data = nexusInteraction.logTiles(
+        instrument, cycles, runs, field, int(level), int(tile))
+    return jsonify(data)
+
+# Get the samples of a run's log fields recorded after a time, for following
+# a run in progress
+
+
+@app.route('/getLogTail/<instrument>/<cycle>/<run>/<fields>/<since>')
+def getLogTail(instrument, cycle, run, fields, since):
+    data = nexusInteraction.logTail(
+        instrument, cycle, run, fields, float(since))
+    return jsonify(data)
+
 # Get instrument cycles
 
 
@@ -388,11 +410,26 @@ def getSpectrum(instrument, cycle, runs, spectra):
     return jsonify(data)
 
 
+@app.route('/getSpectrumBlock/<instrument>/<cycle>/<runs>/<first>/<count>')
+def getSpectrumBlock(instrument, cycle, runs, first, count):
+    data = nexusInteraction.getSpectrumBlock(
+        instrument, cycle, runs, first, count)
+    return jsonify(data)
+
+
 @app.route('/getMonSpectrum/<instrument>/<cycle>/<runs>/<monitor>')
 def getMonSpectrum(instrument, cycle, runs, monitor):
     data = nexusInteraction.getMonSpectrum(instrument, cycle, runs, monitor)
     return jsonify(data)
 
+# Get spectrum flight path geometry
+
+
+@app.route('/getFlightPaths/<instrument>/<cycle>/<runs>/<spectrum>')
+def getFlightPaths(instrument, cycle, runs, spectrum):
+    data = nexusInteraction.flightPaths(instrument, cycle, runs, spectrum)
+    return jsonify(data)
+
 # Get spectra range
 
 
@@ -419,6 +456,14 @@ def getMonitorRange(instrument, cycle, runs):
     return jsonify(data)
 
 
+@app.route('/getDetectorCounts/<instrument>/<cycle>/<run>')
+@app.route('/getDetectorCounts/<instrument>/<cycle>/<run>/<first>/<count>')
+def getDetectorCounts(instrument, cycle, run, first=0, count=-1):
+    data = nexusInteraction.detectorCounts(
+        instrument, cycle, run, int(first), int(count))
+    return Response(data, mimetype='application/octet-stream')
+
+
 @app.route('/getDetectorAnalysis/<instrument>/<cycle>/<run>')
 def getDetectorAnalysis(instrument, cycle, run):
     data = nexusInteraction.detectorAnalysis(instrument, cycle, run)
@@ -471,24 +516,36 @@ def pingCycle(instrument):
         return root[-1].get('name')
     return ("")
 
+# Get journal entries newer than the given run
+
 
 @app.route('/updateJournal/<instrument>/<cycle>/<run>')
-def updateJournal(instrument, cycle):
-    url = dataLocation + 'ndx'
-    url += instrument+'/' + cycle
+def updateJournal(instrument, cycle, run):
+    global localSource
     try:
-        response = urlopen(url)
+        with open(localSource + 'ndx' + instrument+'/'+cycle, "r") as file:
+            root = fromstring(file.read())
     except(Exception):
-        return jsonify({"response": "ERR. url not found"})
-    tree = parse(response)
-    root = tree.getroot()
+        url = dataLocation + 'ndx' + instrument+'/'+cycle
+        try:
+            response = urlopen(url)
+        except(Exception):
+            return jsonify({"response": "ERR. url not found"})
+        tree = parse(response)
+        root = tree.getroot()
     ns = {'tag': 'http://definition.nexusformat.org/schema/3.0'}
+
+    # Runs are appended to the journal in order, so only walk the tail
+    newRuns = []
+    for entry in reversed(list(root)):
+        if (int(entry.find('tag:run_number', ns).text.strip()) <= int(run)):
+            break
+        newRuns.append(entry)
+
     fields = []
-    for run in root:
-        if (run.find('tag:run_number', ns).text.strip() <= run):
-            continue
+    for entry in reversed(newRuns):
         runData = {}
-        for data in run:
+        for data in entry:
             dataId = data.tag.replace(
                 '{http://definition.nexusformat.org/schema/3.0}', '')
             try:
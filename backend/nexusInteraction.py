@@ -2,8 +2,17 @@
 # Copyright (c) 2022 E. Devlin and T. Youngs
 
 from h5py import File
+import functools
+import math
+import numpy as np
 import os
 import platform
+import struct
+
+# Logs with more samples than this are sent as level of detail tiles
+TileFullSamples = 100000
+# Buckets of min/max/mean/count in each aggregated tile
+TileBuckets = 1024
 
 # Set root
 
@@ -19,10 +28,10 @@ def setRoot(inRoot):
     print("inRoot: " + inRoot)
     print("root: " + root)
 
-# Access nexus file
+# Find a run's nexus file
 
 
-def file(instrument, cycle, run):
+def filePath(instrument, cycle, run):
     global root
     print("root (inFile): " + root)
 
@@ -48,7 +57,13 @@ def file(instrument, cycle, run):
                     break
         if nxsDir != "":
             break
+    return nxsDir
+
+# Access nexus file
 
+
+def file(instrument, cycle, run):
+    nxsDir = filePath(instrument, cycle, run)
     try:
         print("nxsDir = " + nxsDir)
         nxsFile = File(nxsDir)
@@ -145,6 +160,106 @@ def fieldData(instrument, cycles, runs, fields):
         data.append(runData(nxsFile, fields, runArr[i]))
     return data
 
+# Run times and samples of a numeric log field (values are None for string
+# logs), kept for the few most recently tiled so that neighbouring tiles do
+# not read the file again. The file's modification time is part of the key,
+# so a run in progress is read again as it grows
+
+
+def logSamples(instrument, cycle, run, field):
+    nxsDir = filePath(instrument, cycle, run)
+    modified = os.path.getmtime(nxsDir) if os.path.isfile(nxsDir) else 0
+    return fileLogSamples(nxsDir, modified, field)
+
+
+@functools.lru_cache(maxsize=8)
+def fileLogSamples(nxsDir, modified, field):
+    nxsFile = File(nxsDir)
+    dataBlock = nxsFile[field.replace(":", "/")]
+    group = dataBlock['value_log'] if 'value_log' in dataBlock else dataBlock
+    times = group['time'][()].astype('float64')
+    values = group['value'][()]
+    if values.ndim != 1 or values.dtype.kind not in 'biuf':
+        values = None
+    else:
+        values = values.astype('float64')
+    return runTimes(nxsFile), times, values
+
+# One tile of a run's log field. Tiles at each level split the log's span
+# evenly; below the finest level each holds per-bucket [time, min, max, mean,
+# count] rows, and at it the raw [time, value] samples
+
+
+def logTile(instrument, cycle, run, field, level, tile):
+    runSpan, times, values = logSamples(instrument, cycle, run, field)
+    if values is None or len(times) <= TileFullSamples:
+        return runData(file(instrument, cycle, run), field, run)
+
+    # Enough levels that finest tiles hold at most two samples per bucket
+    levels = max(0, math.ceil(math.log2(len(times) / (2 * TileBuckets))))
+    level = min(level, levels)
+    first = float(times[0])
+    last = float(times[-1])
+    width = (last - first) / 2 ** level
+    start = first + tile * width
+    end = start + width
+    low = np.searchsorted(times, start, 'left')
+    high = (len(times) if tile >= 2 ** level - 1
+            else np.searchsorted(times, end, 'left'))
+    tileTimes = times[low:high]
+    tileValues = values[low:high]
+
+    blockData = [[run, field, first, last, levels, level, tile, TileBuckets]]
+    if level == levels or len(tileTimes) == 0:
+        blockData += np.column_stack([tileTimes, tileValues]).tolist()
+    else:
+        buckets = np.minimum(((tileTimes - start) / width * TileBuckets)
+                             .astype('int64'), TileBuckets - 1)
+        starts = np.flatnonzero(np.r_[True, buckets[1:] != buckets[:-1]])
+        counts = np.diff(np.r_[starts, len(tileValues)])
+        centres = start + (buckets[starts] + 0.5) * width / TileBuckets
+        blockData += np.column_stack([
+            centres, np.minimum.reduceat(tileValues, starts),
+            np.maximum.reduceat(tileValues, starts),
+            np.add.reduceat(tileValues, starts) / counts, counts]).tolist()
+    return [runSpan, blockData]
+
+# Get one tile of a log field for each run. Only the whole log tiles (level 0)
+# carry the fields header, as later tiles are fetched for a plot already open
+
+
+def logTiles(instrument, cycles, runs, field, level, tile):
+    data = [runFields(instrument, cycles, runs) if level == 0 else []]
+    cycleArr = cycles.split(";")
+    runArr = runs.split(";")
+    for i in range(len(runArr)):
+        data.append(logTile(instrument, cycleArr[i], runArr[i], field, level,
+                            tile))
+    return data
+
+# Samples of a run's log fields recorded after a time (seconds from run
+# start), as a runData block. Read afresh on each call, as the file of a
+# run in progress grows
+
+
+def logTail(instrument, cycle, run, fields, since):
+    nxsFile = file(instrument, cycle, run)
+    tail = [runTimes(nxsFile)]
+    for field in fields.split(";"):
+        dataBlock = nxsFile[field.replace(":", "/")]
+        group = dataBlock['value_log'] if 'value_log' in dataBlock else dataBlock
+        times = group['time'][()].astype('float64')
+        first = int(np.searchsorted(times, since, side='right'))
+        values = group['value'][first:]
+        blockData = [[run, field]]
+        for time, value in zip(times[first:], values):
+            try:
+                blockData.append([float(time), float(value)])
+            except(Exception):
+                blockData.append([float(time), value[0].decode('UTF-8')])
+        tail.append(blockData)
+    return tail
+
 
 def getSpectrum(instrument, cycle, runs, spectra):
     data = [[runs, spectra, "detector"]]
@@ -160,6 +275,21 @@ def getSpectrum(instrument, cycle, runs, spectra):
     return data
 
 
+def getSpectrumBlock(instrument, cycle, runs, first, count):
+    data = [[runs, first, count, "detector"]]
+    for run in runs.split(";"):
+        nxsFile = file(instrument, cycle, run)
+        mainGroup = nxsFile['raw_data_1']
+        time_of_flight = mainGroup["detector_1"]["time_of_flight"]
+        counts = mainGroup["detector_1"]["counts"]
+        # Read the block as one slice rather than spectrum by spectrum
+        last = min(int(first) + int(count), counts.shape[1])
+        block = counts[0, int(first):last]
+        data.append([time_of_flight[()].astype('float64').tolist(),
+                     block.astype('float64').tolist()])
+    return data
+
+
 def getMonSpectrum(instrument, cycle, runs, monitor):
     data = [[runs, monitor, "monitor"]]
     for run in runs.split(";"):
@@ -174,6 +304,33 @@ def getMonSpectrum(instrument, cycle, runs, monitor):
     return data
 
 
+def flightPaths(instrument, cycle, runs, spectrum):
+    # Moderator to sample and sample to detector distances (m) and two theta
+    # (degrees) of a detector spectrum ("detector_<index>") or a monitor
+    # ("monitor_<number>") for each run
+    data = [[runs, spectrum, "flightPath"]]
+    group, index = spectrum.rsplit("_", 1)
+    for run in runs.split(";"):
+        mainGroup = file(instrument, cycle, run)['raw_data_1']
+        instrumentGroup = mainGroup['instrument']
+        detector = instrumentGroup['detector_1']
+        l1 = abs(float(instrumentGroup['moderator']['distance'][()]))
+        if group == "detector":
+            l2 = float(detector['distance'][int(index)])
+            twoTheta = float(detector['polar_angle'][int(index)])
+        else:
+            # Monitors sit in the incident beam, so have no scattering angle
+            monitor = mainGroup[spectrum]
+            if 'distance' in monitor:
+                l2 = float(monitor['distance'][()])
+            else:
+                spectrumIndex = int(monitor['spectrum_index'][()]) - 1
+                l2 = float(detector['distance'][spectrumIndex])
+            twoTheta = 0.0
+        data.append([l1, l2, twoTheta])
+    return data
+
+
 def getSpectrumRange(instrument, cycle, runs):
     run = runs.split(";")[0]
     nxsFile = file(instrument, cycle, run)
@@ -194,6 +351,20 @@ def getMonitorRange(instrument, cycle, runs):
     return int(monRange)
 
 
+def detectorCounts(instrument, cycle, run, first=0, count=-1):
+    # Binary, little endian: spectra and bins (int32), time of flight bin
+    # boundaries (float64) then counts per spectrum (float32). A count of -1
+    # reads every spectrum from first
+    nxsFile = file(instrument, cycle, run)
+    detector = nxsFile['raw_data_1']["detector_1"]
+    timeOfFlight = detector["time_of_flight"][()].astype('<f8')
+    last = detector["counts"].shape[1] if count < 0 else first + count
+    counts = detector["counts"][0, first:last].astype('<f4')
+    spectra, bins = counts.shape
+    return (struct.pack('<ii', spectra, bins) + timeOfFlight.tobytes() +
+            counts.tobytes())
+
+
 def detectorAnalysis(instrument, cycle, run):
     nxsFile = file(instrument, cycle, run)
     detectors = nxsFile['raw_data_1']["detector_1"]["counts"][0]
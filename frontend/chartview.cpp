@@ -2,8 +2,9 @@
 // Copyright (c) 2022 E. Devlin and T. Youngs
 
 #include "chartview.h"
-#include "httprequestworker.h"
+#include "envelope.h"
 #include <QApplication>
+#include <QAreaSeries>
 #include <QBrush>
 #include <QCategoryAxis>
 #include <QDateTime>
@@ -11,18 +12,39 @@
 #include <QDebug>
 #include <QFont>
 #include <QGraphicsSimpleTextItem>
+#include <QLegendMarker>
 #include <QLineSeries>
 #include <QMessageBox>
+#include <QPen>
+#include <QScatterSeries>
 #include <QValueAxis>
 #include <QtGui/QMouseEvent>
+#include <algorithm>
+#include <limits>
+
+// Total buffered samples beyond which series are drawn by the SeriesLayer rather than as chart points
+const qint64 LayerThreshold = 1000000;
+// Interval between chart updates while zooming or panning, in ms (~60 fps)
+const int FrameInterval = 16;
+// Pause in interaction after which the view is redrawn at full quality, in ms
+const int IdleInterval = 150;
+// Reduction in decimation buckets while interacting
+const int DraftReduction = 4;
+// Grid points of the envelope drawn over overlaid series
+const int EnvelopePoints = 8192;
 
 ChartView::ChartView(QChart *chart, QWidget *parent) : QChartView(chart, parent)
 {
     setRubberBand(QChartView::HorizontalRubberBand);
     setDragMode(QGraphicsView::NoDrag);
     this->setMouseTracking(true);
-    hovered_ = "";
+    hovering_ = false;
+    layer_ = nullptr;
+    envelope_ = false;
+    envelopeOutliers_ = false;
+    envelopeDirty_ = false;
     this->setGraphics(chart);
+    createTimers();
 }
 
 ChartView::ChartView(QWidget *parent) : QChartView(parent)
@@ -30,7 +52,37 @@ ChartView::ChartView(QWidget *parent) : QChartView(parent)
     setRubberBand(QChartView::HorizontalRubberBand);
     setDragMode(QGraphicsView::NoDrag);
     this->setMouseTracking(true);
-    hovered_ = "";
+    hovering_ = false;
+    layer_ = nullptr;
+    envelope_ = false;
+    envelopeOutliers_ = false;
+    envelopeDirty_ = false;
+    createTimers();
+}
+
+void ChartView::createTimers()
+{
+    pendingZoom_ = 1.0;
+    interacting_ = false;
+    decimationTimer_ = new QTimer(this);
+    decimationTimer_->setSingleShot(true);
+    connect(decimationTimer_, &QTimer::timeout, this, &ChartView::updateDecimation);
+    frameTimer_ = new QTimer(this);
+    frameTimer_->setSingleShot(true);
+    frameTimer_->setInterval(FrameInterval);
+    connect(frameTimer_, &QTimer::timeout, this, &ChartView::applyInteraction);
+    idleTimer_ = new QTimer(this);
+    idleTimer_->setSingleShot(true);
+    idleTimer_->setInterval(IdleInterval);
+    connect(idleTimer_, &QTimer::timeout, this, &ChartView::endInteraction);
+    hoverTimer_ = new QTimer(this);
+    hoverTimer_->setSingleShot(true);
+    hoverTimer_->setInterval(30);
+    connect(hoverTimer_, &QTimer::timeout, this, &ChartView::updateHover);
+    labelTimer_ = new QTimer(this);
+    labelTimer_->setSingleShot(true);
+    labelTimer_->setInterval(30);
+    connect(labelTimer_, &QTimer::timeout, this, &ChartView::updateCoordinateLabels);
 }
 
 void ChartView::setGraphics(QChart *chart)
@@ -47,6 +99,9 @@ void ChartView::setGraphics(QChart *chart)
     coordStartLabelY_->setBrush(QColor(0, 0, 0, 127));
     coordStartLabelX_->setFont(QFont("Helvetica", 8));
     coordStartLabelY_->setFont(QFont("Helvetica", 8));
+    auto *layer = new SeriesLayer(chart);
+    connect(chart, &QChart::plotAreaChanged, this, [=](const QRectF &plotArea) { layer->setPlotArea(plotArea); });
+    layer_ = layer;
 }
 void ChartView::assignChart(QChart *chart)
 {
@@ -54,82 +109,430 @@ void ChartView::assignChart(QChart *chart)
     this->setGraphics(chart);
 }
 
-void ChartView::addSeries(HttpRequestWorker *worker)
+// Back a series with full resolution data, drawn decimated to the visible range
+void ChartView::setSeriesData(QXYSeries *series, QSharedPointer<SeriesBuffer> data, double xScale, double xOffset)
+{
+    if (!seriesData_.contains(series) && !hibernated_.contains(series))
+        connect(series, &QObject::destroyed, this, [=]() {
+            seriesData_.remove(series);
+            hibernated_.remove(series);
+            envelopeData_.remove(series);
+            if (layer_)
+                layer_->removeSeries(series);
+        });
+    hibernated_.remove(series);
+    seriesData_[series] = {data, xScale, xOffset};
+    envelopeDirty_ = true;
+    scheduleDecimation();
+}
+
+void ChartView::replaceSeriesData(QXYSeries *series, QSharedPointer<SeriesBuffer> data)
+{
+    if (!seriesData_.contains(series))
+        return;
+    seriesData_[series].data = data;
+    envelopeDirty_ = true;
+    scheduleDecimation();
+}
+
+void ChartView::removeSeriesData(QXYSeries *series)
 {
-    QString msg;
-    if (worker->errorType == QNetworkReply::NoError)
+    seriesData_.remove(series);
+    hibernated_.remove(series);
+    series->clear();
+    if (layer_)
+        layer_->removeSeries(series);
+}
+
+void ChartView::hibernate(QSharedPointer<HibernatedBuffers> buffers)
+{
+    for (auto it = seriesData_.cbegin(); it != seriesData_.cend(); ++it)
     {
-        // For each Run
-        auto array = worker->jsonArray;
-        array.removeFirst();
-        foreach (const auto &runFields, array)
+        auto index = buffers->indices.value(it->data.data(), -1);
+        if (index == -1)
         {
-            auto runFieldsArray = runFields.toArray();
-            auto startTime = QDateTime::fromString(runFieldsArray.first()[0].toString(), "yyyy-MM-dd'T'HH:mm:ss");
-            auto endTime = QDateTime::fromString(runFieldsArray.first()[1].toString(), "yyyy-MM-dd'T'HH:mm:ss");
-            runFieldsArray.removeFirst();
+            index = buffers->data.size();
+            buffers->indices[it->data.data()] = index;
+            buffers->data.append(it->data->toBinary());
+        }
+        hibernated_[it.key()] = {index, it->xScale, it->xOffset};
+        it.key()->clear();
+    }
+    seriesData_.clear();
+    hibernatedBuffers_ = buffers;
+    if (layer_)
+        layer_->setSources({});
+}
 
-            // For each field
-            foreach (const auto &fieldData, runFieldsArray)
-            {
-                auto fieldDataArray = fieldData.toArray();
-                auto *series = new QLineSeries();
-                auto endTime = QDateTime::fromString(runFieldsArray.first()[1].toString(), "yyyy-MM-dd'T'HH:mm:ss");
-
-                connect(series, &QLineSeries::hovered,
-                        [=](const QPointF point, bool hovered) { this->setHovered(point, hovered, series->name()); });
-
-                // Set dateSeries ID
-                QString name = fieldDataArray.first()[0].toString();
-                QString field = fieldDataArray.first()[1].toString().section(':', -1);
-                series->setName(name);
-                fieldDataArray.removeFirst();
-
-                foreach (const auto &dataPair, fieldDataArray)
-                {
-                    auto dataPairArray = dataPair.toArray();
-                    if (chart()->axes(Qt::Horizontal)[0]->type() == QAbstractAxis::AxisTypeValue)
-                        series->append(dataPairArray[0].toDouble(), dataPairArray[1].toDouble());
-                    else // if date time axis
-                        series->append(startTime.addSecs(dataPairArray[0].toDouble()).toMSecsSinceEpoch(),
-                                       dataPairArray[1].toDouble());
-
-                    auto *axis = qobject_cast<QValueAxis *>(chart()->axes(Qt::Vertical)[0]);
-                    if (dataPairArray[1].toDouble() < axis->min())
-                        axis->setMin(dataPairArray[1].toDouble());
-                    if (dataPairArray[1].toDouble() > axis->max())
-                        axis->setMax(dataPairArray[1].toDouble());
-                }
-                if (chart()->axes(Qt::Horizontal)[0]->type() == QAbstractAxis::AxisTypeValue)
-                {
-                    auto *axis = qobject_cast<QValueAxis *>(chart()->axes(Qt::Horizontal)[0]);
-                    if (series->at(0).x() < axis->min())
-                        axis->setMin(series->at(0).x());
-                    if (series->at(series->count() - 1).x() > axis->max())
-                        axis->setMax(series->at(series->count() - 1).x());
-                }
-                else
-                {
-                    auto *axis = qobject_cast<QDateTimeAxis *>(chart()->axes(Qt::Horizontal)[0]);
-                    if (startTime.addSecs(startTime.secsTo(QDateTime::fromMSecsSinceEpoch(series->at(0).x()))) < axis->min())
-                        axis->setMin(startTime.addSecs(startTime.secsTo(QDateTime::fromMSecsSinceEpoch(series->at(0).x()))));
-                    if (endTime > axis->max())
-                        axis->setMax(endTime);
-                }
-                chart()->addSeries(series);
-                series->attachAxis(chart()->axes(Qt::Horizontal)[0]);
-                series->attachAxis(chart()->axes(Qt::Vertical)[0]);
-            }
+void ChartView::wake()
+{
+    if (hibernatedBuffers_)
+    {
+        auto &restored = hibernatedBuffers_->restored;
+        restored.resize(hibernatedBuffers_->data.size());
+        for (auto it = hibernated_.cbegin(); it != hibernated_.cend(); ++it)
+        {
+            if (!restored[it->buffer])
+                restored[it->buffer] = SeriesBuffer::fromBinary(hibernatedBuffers_->data[it->buffer]);
+            seriesData_[it.key()] = {restored[it->buffer], it->xScale, it->xOffset};
+        }
+    }
+    hibernated_.clear();
+    hibernatedBuffers_.reset();
+    scheduleDecimation();
+}
+
+bool ChartView::isHibernating() const { return !hibernated_.isEmpty(); }
+
+qint64 ChartView::memoryUsage(QSet<const void *> &counted) const
+{
+    qint64 bytes = 0;
+    for (const auto &buffered : seriesData_)
+        if (!counted.contains(buffered.data.data()))
+        {
+            counted.insert(buffered.data.data());
+            bytes += buffered.data->memoryUsage();
+        }
+    for (const auto &data : envelopeData_)
+        if (!counted.contains(data.data()))
+        {
+            counted.insert(data.data());
+            bytes += data->memoryUsage();
+        }
+    if (hibernatedBuffers_ && !counted.contains(hibernatedBuffers_.data()))
+    {
+        counted.insert(hibernatedBuffers_.data());
+        for (const auto &data : hibernatedBuffers_->data)
+            bytes += data.size();
+    }
+    for (auto *series : chart()->series())
+        if (auto *xySeries = qobject_cast<QXYSeries *>(series))
+            bytes += xySeries->count() * (qint64)sizeof(QPointF);
+    return bytes;
+}
+
+void ChartView::setEnvelope(bool enabled, bool showOutliers)
+{
+    envelope_ = enabled;
+    envelopeOutliers_ = showOutliers;
+    updateEnvelope();
+}
+
+void ChartView::setEnvelopeData(QXYSeries *series, QSharedPointer<SeriesBuffer> data)
+{
+    if (!seriesData_.contains(series))
+        return;
+    envelopeData_[series] = data;
+    envelopeDirty_ = true;
+    scheduleDecimation();
+}
+
+void ChartView::updateEnvelope()
+{
+    envelopeDirty_ = false;
+    for (auto *series : envelopeSeries_)
+    {
+        chart()->removeSeries(series);
+        delete series;
+    }
+    envelopeSeries_.clear();
+
+    // Runs are the buffered line series, grouped by the field (or derived channel) they show, as only the same
+    // quantity can be summarised. Markers drawn over them, and live continuations of runs, are left as they are
+    QStringList fields;
+    QVector<QVector<QXYSeries *>> runs;
+    QVector<QVector<Envelope::Member>> members;
+    for (auto it = seriesData_.cbegin(); it != seriesData_.cend(); ++it)
+    {
+        if (qobject_cast<QScatterSeries *>(it.key()) || it.key()->property("live").toBool() ||
+            (it.key()->property("tiled").toBool() && !envelopeData_.contains(it.key())))
+            continue;
+        auto field = it.key()->property("field").toString();
+        auto group = fields.indexOf(field);
+        if (group == -1)
+        {
+            group = fields.size();
+            fields.append(field);
+            runs.append({});
+            members.append({});
+        }
+        runs[group].append(it.key());
+        members[group].append({envelopeData_.value(it.key(), it->data), it->xScale, it->xOffset});
+    }
+    auto setRunVisible = [&](QXYSeries *series, bool visible) {
+        series->setVisible(visible);
+        for (auto *marker : chart()->legend()->markers(series))
+            marker->setVisible(visible);
+    };
+    for (const auto &groupRuns : runs)
+        for (auto *series : groupRuns)
+            setRunVisible(series, !envelope_);
+    if (!envelope_)
+        return;
+
+    // The envelope shares the axes of the runs, with its bands drawn translucent so outliers show through
+    auto addSeries = [&](QAbstractSeries *series, const QList<QAbstractAxis *> &axes) {
+        series->setObjectName("envelope");
+        chart()->addSeries(series);
+        for (auto *axis : axes)
+            series->attachAxis(axis);
+        envelopeSeries_.append(series);
+    };
+    for (auto group = 0; group < fields.size(); ++group)
+    {
+        Envelope envelope;
+        envelope.compute(members[group], EnvelopePoints);
+        if (envelopeOutliers_)
+            for (auto index : envelope.outliers)
+                setRunVisible(runs[group][index], true);
+
+        auto axes = runs[group].first()->attachedAxes();
+        auto suffix = fields.size() > 1 ? " (" + fields[group] + ")" : QString();
+        auto colour = QColor::fromHsv((207 + group * 67) % 360, 155, 180);
+        auto line = [&](const QVector<double> &y) {
+            QList<QPointF> points;
+            points.reserve(envelope.x.size());
+            for (auto i = 0; i < envelope.x.size(); ++i)
+                points.append(QPointF(envelope.x[i], y[i]));
+            auto *series = new QLineSeries();
+            series->replace(points);
+            return series;
+        };
+        auto band = [&](QString name, const QVector<double> &lower, const QVector<double> &upper, int alpha) {
+            auto *upperSeries = line(upper);
+            auto *lowerSeries = line(lower);
+            auto *area = new QAreaSeries(upperSeries, lowerSeries);
+            upperSeries->setParent(area);
+            lowerSeries->setParent(area);
+            area->setName(name + suffix);
+            auto bandColour = colour;
+            bandColour.setAlpha(alpha);
+            area->setColor(bandColour);
+            area->setPen(Qt::NoPen);
+            addSeries(area, axes);
+        };
+        band("Min-max", envelope.min, envelope.max, 60);
+        band("10-90%", envelope.lower, envelope.upper, 110);
+        auto *mean = line(envelope.mean);
+        mean->setName("Mean" + suffix);
+        mean->setPen(QPen(colour.darker(160), 2));
+        addSeries(mean, axes);
+    }
+}
+
+// Coalesce view changes into a single re-decimation
+void ChartView::scheduleDecimation()
+{
+    if (!seriesData_.isEmpty())
+        decimationTimer_->start(0);
+}
+
+// Coalesce wheel and drag input into the next frame, and hold draft quality until it pauses
+void ChartView::scheduleInteraction()
+{
+    interacting_ = true;
+    if (!frameTimer_->isActive())
+        frameTimer_->start();
+    idleTimer_->start();
+}
+
+void ChartView::applyInteraction()
+{
+    if (!pendingScroll_.isNull())
+        chart()->scroll(pendingScroll_.x(), pendingScroll_.y());
+    if (pendingZoom_ != 1.0)
+    {
+        // Zoom about the cursor, keeping the value beneath it in place
+        auto graphArea = QRectF(chart()->plotArea().left(), chart()->plotArea().top(),
+                                chart()->plotArea().width() / pendingZoom_, chart()->plotArea().height() / pendingZoom_);
+        graphArea.moveCenter(zoomCentre_);
+        chart()->zoomIn(graphArea);
+        auto delta = chart()->plotArea().center() - zoomCentre_;
+        chart()->scroll(delta.x(), -delta.y());
+    }
+    pendingScroll_ = QPointF();
+    pendingZoom_ = 1.0;
+    scheduleDecimation();
+}
+
+void ChartView::endInteraction()
+{
+    interacting_ = false;
+    scheduleDecimation();
+}
+
+void ChartView::updateDecimation()
+{
+    if (seriesData_.isEmpty() || chart()->axes(Qt::Horizontal).isEmpty() || !isVisible())
+        return;
+    if (envelope_ && envelopeDirty_)
+        updateEnvelope();
+    if (!interacting_)
+        emit viewChanged();
+
+    // Follow range changes made outside the view's own zoom and pan, e.g. resets
+    for (auto *axis : chart()->axes())
+        if (auto *dateTimeAxis = qobject_cast<QDateTimeAxis *>(axis))
+            connect(dateTimeAxis, &QDateTimeAxis::rangeChanged, this, &ChartView::scheduleDecimation,
+                    Qt::UniqueConnection);
+        else if (auto *valueAxis = qobject_cast<QValueAxis *>(axis))
+            connect(valueAxis, &QValueAxis::rangeChanged, this, &ChartView::scheduleDecimation, Qt::UniqueConnection);
+
+    // Very large views are painted straight from their buffers, leaving the series empty
+    qint64 samples = 0;
+    for (const auto &buffered : seriesData_)
+        samples += buffered.data->size();
+    auto buckets = std::max((int)chart()->plotArea().width() / (interacting_ ? DraftReduction : 1), 1);
+    if (layer_ && samples > LayerThreshold)
+    {
+        QVector<SeriesLayer::Source> sources;
+        for (auto it = seriesData_.cbegin(); it != seriesData_.cend(); ++it)
+        {
+            sources.append({it.key(), it->data, it->xScale, it->xOffset});
+            if (it.key()->count() > 0)
+                it.key()->clear();
         }
+        layer_->setSources(sources, buckets);
+        return;
+    }
+    if (layer_)
+        layer_->setSources({});
+
+    qreal minX;
+    qreal maxX;
+    horizontalRange(minX, maxX);
+    // Scatter series are thinned to a point per cell of half a marker, as their samples do not form a line
+    auto rows = std::max((int)chart()->plotArea().height() / (interacting_ ? DraftReduction : 1), 1);
+    auto *yAxis = qobject_cast<QValueAxis *>(chart()->axes(Qt::Vertical).value(0));
+    for (auto it = seriesData_.begin(); it != seriesData_.end(); ++it)
+    {
+        auto *scatter = qobject_cast<QScatterSeries *>(it.key());
+        if (scatter && yAxis)
+        {
+            auto cell = std::max(scatter->markerSize() / 2, 1.0);
+            it.key()->replace(it->data->thinned(minX, maxX, yAxis->min(), yAxis->max(), int(buckets / cell),
+                                                int(rows / cell), it->xScale, it->xOffset));
+        }
+        else
+            it.key()->replace(it->data->decimated(minX, maxX, buckets, it->xScale, it->xOffset));
+    }
+}
+
+bool ChartView::seriesRange(QXYSeries *series, double &min, double &max)
+{
+    if (!seriesData_.contains(series) || chart()->axes(Qt::Horizontal).isEmpty())
+        return false;
+    auto buffered = seriesData_.value(series);
+    qreal minX;
+    qreal maxX;
+    horizontalRange(minX, maxX);
+    min = (minX - buffered.xOffset) / buffered.xScale;
+    max = (maxX - buffered.xOffset) / buffered.xScale;
+    return true;
+}
+
+void ChartView::follow(QXYSeries *series, double previousEnd)
+{
+    if (!seriesData_.contains(series) || seriesData_[series].data->size() == 0)
+        return;
+    const auto &buffered = seriesData_[series];
+    auto end = buffered.data->x(buffered.data->size() - 1) * buffered.xScale + buffered.xOffset;
+    auto previous = previousEnd * buffered.xScale + buffered.xOffset;
+    qreal minX;
+    qreal maxX;
+    horizontalRange(minX, maxX);
+    if (maxX < previous || maxX >= end)
+        return;
+
+    // Keep the width in view, moving its right edge to the newest sample
+    auto shift = end - maxX;
+    auto *xAxis = chart()->axes(Qt::Horizontal)[0];
+    if (xAxis->type() == QAbstractAxis::AxisTypeDateTime)
+        qobject_cast<QDateTimeAxis *>(xAxis)->setRange(QDateTime::fromMSecsSinceEpoch(minX + shift),
+                                                      QDateTime::fromMSecsSinceEpoch(end));
+    else
+        qobject_cast<QValueAxis *>(xAxis)->setRange(minX + shift, end);
+    scheduleDecimation();
+}
+
+// Get visible horizontal range in series coordinates
+void ChartView::horizontalRange(qreal &min, qreal &max)
+{
+    if (chart()->axes(Qt::Horizontal)[0]->type() == QAbstractAxis::AxisTypeDateTime)
+    {
+        auto *xAxis = qobject_cast<QDateTimeAxis *>(chart()->axes(Qt::Horizontal)[0]);
+        min = xAxis->min().toMSecsSinceEpoch();
+        max = xAxis->max().toMSecsSinceEpoch();
     }
     else
     {
-        // an error occurred
-        msg = "Error2: " + worker->errorString;
-        QMessageBox::information(this, "", msg);
+        auto *xAxis = qobject_cast<QValueAxis *>(chart()->axes(Qt::Horizontal)[0]);
+        min = xAxis->min();
+        max = xAxis->max();
     }
 }
 
+// Add parsed log series, updating each axis range once
+void ChartView::addLogSeries(const QVector<LogSeries> &logSeries)
+{
+    auto *xAxis = chart()->axes(Qt::Horizontal)[0];
+    auto *yAxis = chart()->axes(Qt::Vertical)[0];
+    auto dateTime = xAxis->type() == QAbstractAxis::AxisTypeDateTime;
+
+    // Grow the current ranges, or start afresh on an empty chart
+    qreal minX = std::numeric_limits<qreal>::max();
+    qreal maxX = std::numeric_limits<qreal>::lowest();
+    qreal minY = minX;
+    qreal maxY = maxX;
+    if (!chart()->series().isEmpty())
+    {
+        horizontalRange(minX, maxX);
+        minY = qobject_cast<QValueAxis *>(yAxis)->min();
+        maxY = qobject_cast<QValueAxis *>(yAxis)->max();
+    }
+
+    for (const auto &log : logSeries)
+    {
+        if (log.data->size() == 0)
+            continue;
+        auto *series = new QLineSeries();
+        series->setName(log.run);
+        series->setProperty("field", log.field);
+        series->setProperty("tiled", log.tileLevels > 0);
+
+        // Relative times are stored once and shifted to absolute time when drawn
+        qreal xScale = 1.0;
+        qreal xOffset = 0.0;
+        qreal runEnd = log.startTime.msecsTo(log.endTime) / 1000.0;
+        if (dateTime)
+        {
+            xScale = 1000.0;
+            xOffset = log.startTime.toMSecsSinceEpoch();
+            runEnd = log.endTime.toMSecsSinceEpoch();
+        }
+        minX = std::min({minX, xOffset, log.data->x(0) * xScale + xOffset});
+        maxX = std::max({maxX, runEnd, log.data->x(log.data->size() - 1) * xScale + xOffset});
+        minY = std::min(minY, log.data->minY());
+        maxY = std::max(maxY, log.data->maxY());
+
+        setSeriesData(series, log.data, xScale, xOffset);
+        chart()->addSeries(series);
+        series->attachAxis(xAxis);
+        series->attachAxis(yAxis);
+    }
+    if (maxX < minX)
+        return;
+
+    if (dateTime)
+        qobject_cast<QDateTimeAxis *>(xAxis)->setRange(QDateTime::fromMSecsSinceEpoch(minX),
+                                                      QDateTime::fromMSecsSinceEpoch(maxX));
+    else
+        qobject_cast<QValueAxis *>(xAxis)->setRange(minX, maxX);
+    // Category axes keep their labelled range
+    if (yAxis->type() != QAbstractAxis::AxisTypeCategory)
+        qobject_cast<QValueAxis *>(yAxis)->setRange(minY, maxY);
+}
+
 void ChartView::keyPressEvent(QKeyEvent *event)
 {
     {
@@ -137,24 +540,25 @@ void ChartView::keyPressEvent(QKeyEvent *event)
         {
             case Qt::Key_Control:
                 setRubberBand(QChartView::VerticalRubberBand);
-                break;
+                return;
             case Qt::Key_Left:
-                chart()->scroll(-10, 0);
+                pendingScroll_ += QPointF(-10, 0);
                 break;
             case Qt::Key_Right:
-                chart()->scroll(10, 0);
+                pendingScroll_ += QPointF(10, 0);
                 break;
             case Qt::Key_Up:
-                chart()->scroll(0, 10);
+                pendingScroll_ += QPointF(0, 10);
                 break;
             case Qt::Key_Down:
-                chart()->scroll(0, -10);
+                pendingScroll_ += QPointF(0, -10);
                 break;
             default:
                 QGraphicsView::keyPressEvent(event);
-                break;
+                return;
         }
     }
+    scheduleInteraction();
 }
 
 void ChartView::keyReleaseEvent(QKeyEvent *event)
@@ -171,13 +575,10 @@ void ChartView::wheelEvent(QWheelEvent *event)
     else
         factor = 0.91;
 
-    auto graphArea = QRectF(chart()->plotArea().left(), chart()->plotArea().top(), chart()->plotArea().width() / factor,
-                            chart()->plotArea().height() / factor);
-    auto mousePos = mapFromGlobal(QCursor::pos());
-    graphArea.moveCenter(mousePos);
-    chart()->zoomIn(graphArea);
-    auto delta = chart()->plotArea().center() - mousePos;
-    chart()->scroll(delta.x(), -delta.y());
+    // Ticks arriving within a frame compound into a single zoom
+    pendingZoom_ *= factor;
+    zoomCentre_ = mapFromGlobal(QCursor::pos());
+    scheduleInteraction();
 }
 
 void ChartView::mousePressEvent(QMouseEvent *event)
@@ -197,7 +598,11 @@ void ChartView::mouseReleaseEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::RightButton)
     {
+        frameTimer_->stop();
+        pendingScroll_ = QPointF();
+        pendingZoom_ = 1.0;
         chart()->zoomReset();
+        scheduleDecimation();
         return;
     }
     if (event->button() == Qt::MiddleButton)
@@ -206,16 +611,107 @@ void ChartView::mouseReleaseEvent(QMouseEvent *event)
     }
     if (event->button() == Qt::LeftButton)
     {
+        labelTimer_->stop();
         coordLabelX_->setText("");
         coordLabelY_->setText("");
         coordStartLabelX_->setText("");
         coordStartLabelY_->setText("");
     }
     QChartView::mouseReleaseEvent(event);
+    // Rubber band zoom is applied on release
+    scheduleDecimation();
+}
+
+void ChartView::resizeEvent(QResizeEvent *event)
+{
+    QChartView::resizeEvent(event);
+    scheduleDecimation();
+}
+
+void ChartView::showEvent(QShowEvent *event)
+{
+    QChartView::showEvent(event);
+    scheduleDecimation();
+}
+
+// Find the sample nearest the cursor over all series, within a few pixels of it
+bool ChartView::nearestPoint(QPointF position, QString &name, QPointF &nearest)
+{
+    const qreal radius = 6;
+    if (chart()->axes(Qt::Horizontal).isEmpty() || chart()->axes(Qt::Vertical).isEmpty())
+        return false;
+
+    // Linear map from values to pixels, shared by every series on the chart axes
+    qreal minX;
+    qreal maxX;
+    horizontalRange(minX, maxX);
+    auto *yAxis = qobject_cast<QValueAxis *>(chart()->axes(Qt::Vertical)[0]);
+    auto plotArea = chart()->plotArea();
+    if (!yAxis || maxX <= minX || yAxis->max() <= yAxis->min())
+        return false;
+    auto xPerPixel = (maxX - minX) / plotArea.width();
+    auto yPerPixel = (yAxis->max() - yAxis->min()) / plotArea.height();
+    auto cursorX = minX + (position.x() - plotArea.left()) * xPerPixel;
+    auto cursorY = yAxis->min() + (plotArea.bottom() - position.y()) * yPerPixel;
+
+    auto bestDistance = radius * radius;
+    auto found = false;
+    auto consider = [&](QXYSeries *series, qreal x, qreal y) {
+        auto dx = (x - cursorX) / xPerPixel;
+        auto dy = (y - cursorY) / yPerPixel;
+        if (dx * dx + dy * dy < bestDistance)
+        {
+            bestDistance = dx * dx + dy * dy;
+            name = series->name();
+            nearest = QPointF(x, y);
+            found = true;
+        }
+    };
+
+    for (auto *abstractSeries : chart()->series())
+    {
+        auto *series = qobject_cast<QXYSeries *>(abstractSeries);
+        if (!series || !series->isVisible())
+            continue;
+
+        // Binary search for the samples within reach of the cursor, then check their values
+        if (seriesData_.contains(series))
+        {
+            auto buffered = seriesData_.value(series);
+            auto first = buffered.data->lowerBound((cursorX - radius * xPerPixel - buffered.xOffset) / buffered.xScale);
+            auto last = buffered.data->lowerBound((cursorX + radius * xPerPixel - buffered.xOffset) / buffered.xScale);
+            for (auto i = first; i < last; ++i)
+                consider(series, buffered.data->x(i) * buffered.xScale + buffered.xOffset, buffered.data->y(i));
+        }
+        else
+        {
+            const auto points = series->points();
+            auto byX = [](const QPointF &point, qreal x) { return point.x() < x; };
+            auto first = std::lower_bound(points.cbegin(), points.cend(), cursorX - radius * xPerPixel, byX);
+            auto last = std::lower_bound(first, points.cend(), cursorX + radius * xPerPixel, byX);
+            for (auto it = first; it != last; ++it)
+                consider(series, it->x(), it->y());
+        }
+    }
+    return found;
 }
 
-// Set value for hover behaviour
-void ChartView::setHovered(const QPointF point, bool hovered, QString title) { hovered_ = hovered ? title : ""; }
+// Report the nearest sample once per throttle interval
+void ChartView::updateHover()
+{
+    QString name;
+    QPointF nearest;
+    if (nearestPoint(hoverPos_, name, nearest))
+    {
+        hovering_ = true;
+        emit showCoordinates(nearest.x(), nearest.y(), name);
+    }
+    else if (hovering_)
+    {
+        hovering_ = false;
+        emit clearCoordinates();
+    }
+}
 
 void ChartView::mouseMoveEvent(QMouseEvent *event)
 {
@@ -223,99 +719,111 @@ void ChartView::mouseMoveEvent(QMouseEvent *event)
     if (event->buttons() & Qt::MiddleButton)
     {
         auto dPos = event->pos() - lastMousePos_;
-        chart()->scroll(-dPos.x(), dPos.y());
+        pendingScroll_ += QPointF(-dPos.x(), dPos.y());
+        scheduleInteraction();
 
         lastMousePos_ = event->pos();
         event->accept();
     }
     else if (event->buttons() & Qt::LeftButton)
     {
-        auto x = (event->pos()).x();
-        auto y = (event->pos()).y();
+        // Update at once when idle, so the start labels mark the press, then once per interval
+        labelPos_ = event->pos();
+        if (!labelTimer_->isActive())
+        {
+            updateCoordinateLabels();
+            labelTimer_->start();
+        }
+    }
+    else
+    {
+        hoverPos_ = event->pos();
+        if (!hoverTimer_->isActive())
+            hoverTimer_->start();
+    }
+    event->accept();
 
-        // map mouse position to chart
-        auto xVal = chart()->mapToValue(event->pos()).x();
-        auto yVal = chart()->mapToValue(event->pos()).y();
+    QChartView::mouseMoveEvent(event);
+}
 
-        qreal maxX;
-        qreal minX;
-        qreal maxY;
-        qreal minY;
+// Follow a rubber band drag with coordinate labels once per throttle interval
+void ChartView::updateCoordinateLabels()
+{
+    auto x = labelPos_.x();
+    auto y = labelPos_.y();
 
-        // Configure coordinate boundaries to different chart types
-        if (chart()->axes(Qt::Horizontal)[0]->type() == QAbstractAxis::AxisTypeValue)
-        {
-            auto *xAxis = qobject_cast<QValueAxis *>(chart()->axes(Qt::Horizontal)[0]);
-            maxX = xAxis->max();
-            minX = xAxis->min();
-        }
-        else
-        {
-            auto *xAxis = qobject_cast<QDateTimeAxis *>(chart()->axes(Qt::Horizontal)[0]);
-            maxX = xAxis->max().toMSecsSinceEpoch();
-            minX = xAxis->min().toMSecsSinceEpoch();
-        }
-        auto *yAxis = qobject_cast<QValueAxis *>(chart()->axes(Qt::Vertical)[0]);
-        maxY = yAxis->max();
-        minY = yAxis->min();
+    // map mouse position to chart
+    auto xVal = chart()->mapToValue(labelPos_).x();
+    auto yVal = chart()->mapToValue(labelPos_).y();
 
-        // if mouse in chart boundaries
-        if (xVal <= maxX && xVal >= minX && (yVal <= maxY && yVal >= minY || maxY == 0 && minY == 0))
+    qreal maxX;
+    qreal minX;
+    qreal maxY;
+    qreal minY;
+
+    // Configure coordinate boundaries to different chart types
+    if (chart()->axes(Qt::Horizontal)[0]->type() == QAbstractAxis::AxisTypeValue)
+    {
+        auto *xAxis = qobject_cast<QValueAxis *>(chart()->axes(Qt::Horizontal)[0]);
+        maxX = xAxis->max();
+        minX = xAxis->min();
+    }
+    else
+    {
+        auto *xAxis = qobject_cast<QDateTimeAxis *>(chart()->axes(Qt::Horizontal)[0]);
+        maxX = xAxis->max().toMSecsSinceEpoch();
+        minX = xAxis->min().toMSecsSinceEpoch();
+    }
+    auto *yAxis = qobject_cast<QValueAxis *>(chart()->axes(Qt::Vertical)[0]);
+    maxY = yAxis->max();
+    minY = yAxis->min();
+
+    // if mouse in chart boundaries
+    if (xVal <= maxX && xVal >= minX && (yVal <= maxY && yVal >= minY || maxY == 0 && minY == 0))
+    {
+        // map mouse to axis position
+        auto xPosOnAxis = chart()->mapToPosition(QPointF(x, minY));
+        auto yPosOnAxis = chart()->mapToPosition(QPointF(minX, y));
+
+        // move labels to axis offset
+        coordLabelX_->setPos(x, xPosOnAxis.y() - 12);
+        coordLabelY_->setPos(yPosOnAxis.x() + 1, y - 11);
+
+        // configure stationary start labels
+        if (coordStartLabelX_->text() == "")
+            coordStartLabelX_->setPos(x + 1, xPosOnAxis.y() - 12);
+        if (coordStartLabelY_->text() == "")
+            coordStartLabelY_->setPos(yPosOnAxis.x() + 1, y + 1);
+
+        // change labels based on rubber band type
+        if (rubberBand() == QChartView::HorizontalRubberBand)
         {
-            // map mouse to axis position
-            auto xPosOnAxis = chart()->mapToPosition(QPointF(x, minY));
-            auto yPosOnAxis = chart()->mapToPosition(QPointF(minX, y));
-
-            // move labels to axis offset
-            coordLabelX_->setPos(x, xPosOnAxis.y() - 12);
-            coordLabelY_->setPos(yPosOnAxis.x() + 1, y - 11);
-
-            // configure stationary start labels
-            if (coordStartLabelX_->text() == "")
-                coordStartLabelX_->setPos(x + 1, xPosOnAxis.y() - 12);
-            if (coordStartLabelY_->text() == "")
-                coordStartLabelY_->setPos(yPosOnAxis.x() + 1, y + 1);
-
-            // change labels based on rubber band type
-            if (rubberBand() == QChartView::HorizontalRubberBand)
+            // configure label text to reflect axis type
+            if (chart()->axes(Qt::Horizontal)[0]->type() == QAbstractAxis::AxisTypeValue)
             {
-                // configure label text to reflect axis type
-                if (chart()->axes(Qt::Horizontal)[0]->type() == QAbstractAxis::AxisTypeValue)
-                {
-                    coordLabelX_->setText(QString::number(xVal));
-                    // holds initial mouse pos
-                    if (coordStartLabelX_->text() == "")
-                        coordStartLabelX_->setText(QString::number(xVal));
-                }
-                else
-                {
-                    coordLabelX_->setText(QDateTime::fromMSecsSinceEpoch(xVal).toString("yyyy-MM-dd HH:mm:ss"));
-                    // holds initial mouse pos
-                    if (coordStartLabelX_->text() == "")
-                        coordStartLabelX_->setText(QDateTime::fromMSecsSinceEpoch(xVal).toString("yyyy-MM-dd HH:mm:ss"));
-                }
+                coordLabelX_->setText(QString::number(xVal));
+                // holds initial mouse pos
+                if (coordStartLabelX_->text() == "")
+                    coordStartLabelX_->setText(QString::number(xVal));
             }
             else
             {
-                if (maxY == 0 && minY == 0)
-                    coordLabelY_->setText("");
-                else
-                {
-                    coordLabelY_->setText(QString::number(yVal));
-                    if (coordStartLabelY_->text() == "")
-                        coordStartLabelY_->setText(QString::number(yVal));
-                }
+                coordLabelX_->setText(QDateTime::fromMSecsSinceEpoch(xVal).toString("yyyy-MM-dd HH:mm:ss"));
+                // holds initial mouse pos
+                if (coordStartLabelX_->text() == "")
+                    coordStartLabelX_->setText(QDateTime::fromMSecsSinceEpoch(xVal).toString("yyyy-MM-dd HH:mm:ss"));
             }
         }
-    }
-    else
-    {
-        if (!hovered_.isEmpty())
-            emit showCoordinates(chart()->mapToValue(event->pos()).x(), chart()->mapToValue(event->pos()).y(), hovered_);
         else
-            emit clearCoordinates();
+        {
+            if (maxY == 0 && minY == 0)
+                coordLabelY_->setText("");
+            else
+            {
+                coordLabelY_->setText(QString::number(yVal));
+                if (coordStartLabelY_->text() == "")
+                    coordStartLabelY_->setText(QString::number(yVal));
+            }
+        }
     }
-    event->accept();
-
-    QChartView::mouseMoveEvent(event);
-}
\ No newline at end of file
+}
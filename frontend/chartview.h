@@ -4,7 +4,15 @@
 #ifndef CHARTVIEW_H
 #define CHARTVIEW_H
 
-#include "httprequestworker.h"
+#include "logdata.h"
+#include "seriesbuffer.h"
+#include "serieslayer.h"
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QXYSeries>
 #include <QtCharts/QChartView>
 #include <QtWidgets/QRubberBand>
 
@@ -16,14 +24,46 @@ class ChartView : public QChartView
     ChartView(QChart *chart, QWidget *parent = 0);
     ChartView(QWidget *parent = 0);
     void assignChart(QChart *chart);
+    void setSeriesData(QXYSeries *series, QSharedPointer<SeriesBuffer> data, double xScale = 1.0, double xOffset = 0.0);
+    // Swap the data behind a series, keeping its x transform
+    void replaceSeriesData(QXYSeries *series, QSharedPointer<SeriesBuffer> data);
+    // Drop the data behind a series, leaving it empty
+    void removeSeriesData(QXYSeries *series);
+    // Visible horizontal range in a buffered series' own x units
+    bool seriesRange(QXYSeries *series, double &min, double &max);
+    // Scroll to keep a growing series' newest samples in view, if the view reached its previous end
+    void follow(QXYSeries *series, double previousEnd);
+    // Series data set aside by hibernating the views of a tab, each buffer stored once however many series share it
+    struct HibernatedBuffers
+    {
+        QHash<const SeriesBuffer *, int> indices;
+        // SeriesBuffer::toBinary() of each buffer
+        QVector<QByteArray> data;
+        // Buffers restored so far on waking, so the views share them again
+        QVector<QSharedPointer<SeriesBuffer>> restored;
+    };
+    // Set aside full resolution data while the view is not shown, into buffers shared by the tab, and restore it
+    void hibernate(QSharedPointer<HibernatedBuffers> buffers);
+    void wake();
+    bool isHibernating() const;
+    // Heap held for series data and points, in bytes, excluding buffers (or hibernated data) already counted
+    qint64 memoryUsage(QSet<const void *> &counted) const;
+    // Draw overlaid series as the mean of each field within min/max and percentile bands, optionally keeping outliers
+    void setEnvelope(bool enabled, bool showOutliers = false);
+    // Whole samples of a series drawn from level of detail tiles, for the envelope statistics. Until they are set the
+    // series is left out of the envelope, as its tiles hold min/max pairs
+    void setEnvelopeData(QXYSeries *series, QSharedPointer<SeriesBuffer> data);
 
     public slots:
-    void setHovered(const QPointF point, bool hovered, QString title);
-    void addSeries(HttpRequestWorker *worker);
+    void addLogSeries(const QVector<LogSeries> &logSeries);
+    void updateDecimation();
+    void updateHover();
 
     signals:
     void showCoordinates(qreal x, qreal y, QString title);
     void clearCoordinates();
+    // The visible range settled after a change, for views loading detail on demand
+    void viewChanged();
 
     protected:
     void keyPressEvent(QKeyEvent *event);
@@ -32,13 +72,68 @@ class ChartView : public QChartView
     void mousePressEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *event);
     void mouseMoveEvent(QMouseEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void showEvent(QShowEvent *event);
 
     private slots:
     void setGraphics(QChart *chart);
+    // Apply the zoom and scroll gathered since the last frame
+    void applyInteraction();
+    // Redraw at full quality once interaction pauses
+    void endInteraction();
+    void updateCoordinateLabels();
 
     private:
+    void createTimers();
+    void scheduleInteraction();
+    void scheduleDecimation();
+    void horizontalRange(qreal &min, qreal &max);
+    bool nearestPoint(QPointF position, QString &name, QPointF &nearest);
+    // Rebuild the envelope series from the buffered line series, hiding those it stands in for
+    void updateEnvelope();
+
+    // Full resolution data behind each decimated series, and the x transform it is drawn with
+    struct BufferedSeries
+    {
+        QSharedPointer<SeriesBuffer> data;
+        double xScale;
+        double xOffset;
+    };
+    QMap<QXYSeries *, BufferedSeries> seriesData_;
+    // Series data set aside by hibernate(), as an index into the tab's hibernated buffers with its x transform
+    struct HibernatedSeries
+    {
+        int buffer;
+        double xScale;
+        double xOffset;
+    };
+    QMap<QXYSeries *, HibernatedSeries> hibernated_;
+    QSharedPointer<HibernatedBuffers> hibernatedBuffers_;
+    // Painter drawing the buffered series once they are too large to hand to the chart as points
+    SeriesLayer *layer_;
+    // Envelope mode, whether its statistics are out of date, and the series drawing it
+    bool envelope_;
+    bool envelopeOutliers_;
+    bool envelopeDirty_;
+    QList<QAbstractSeries *> envelopeSeries_;
+    QHash<QXYSeries *, QSharedPointer<SeriesBuffer>> envelopeData_;
+    QTimer *decimationTimer_;
+    // Wheel and drag input coalesced into one chart update per frame
+    QTimer *frameTimer_;
+    QTimer *idleTimer_;
+    qreal pendingZoom_;
+    QPointF zoomCentre_;
+    QPointF pendingScroll_;
+    // Decimate coarsely while zooming or panning
+    bool interacting_;
+    // Throttled hover readout
+    QTimer *hoverTimer_;
+    QPointF hoverPos_;
+    bool hovering_;
     QPointF lastMousePos_;
-    QString hovered_;
+    // Throttled rubber band coordinate labels
+    QTimer *labelTimer_;
+    QPointF labelPos_;
     QGraphicsSimpleTextItem *coordLabelX_;
     QGraphicsSimpleTextItem *coordLabelY_;
     QGraphicsSimpleTextItem *coordStartLabelX_;
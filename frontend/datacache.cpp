@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "datacache.h"
+#include <algorithm>
+
+DataCache::DataCache(int maxMegabytes) { setMaxMegabytes(maxMegabytes); }
+
+QString DataCache::key(QString source, QString instrument, QString cycle, QString run, QString item)
+{
+    return source + "/" + instrument + "/" + cycle.trimmed() + "/" + run + "/" + item;
+}
+
+bool DataCache::contains(const QString &key) const { return cache_.contains(key); }
+
+QJsonArray DataCache::value(const QString &key)
+{
+    auto *block = cache_.object(key);
+    return block ? *block : QJsonArray();
+}
+
+void DataCache::insert(const QString &key, const QJsonArray &block) { cache_.insert(key, new QJsonArray(block), cost(block)); }
+
+void DataCache::clear() { cache_.clear(); }
+
+int DataCache::maxMegabytes() const { return cache_.maxCost() / 1024; }
+void DataCache::setMaxMegabytes(int maxMegabytes) { cache_.setMaxCost(std::max(maxMegabytes, 0) * 1024); }
+
+// Approximate size in memory of a block from its number of values
+int DataCache::cost(const QJsonArray &block)
+{
+    qint64 values = 0;
+    for (const auto &value : block)
+    {
+        if (value.isArray())
+            values += value.toArray().count();
+        ++values;
+    }
+    return std::max<qint64>(values * 16 / 1024, 1);
+}
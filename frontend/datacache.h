@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef DATACACHE_H
+#define DATACACHE_H
+
+#include <QCache>
+#include <QJsonArray>
+#include <QString>
+
+// Memory capped, least recently used cache of per-run data blocks (spectra, monitor spectra and log fields)
+class DataCache
+{
+    public:
+    DataCache(int maxMegabytes = 256);
+
+    static QString key(QString source, QString instrument, QString cycle, QString run, QString item);
+
+    bool contains(const QString &key) const;
+    // Get a block, marking it as most recently used
+    QJsonArray value(const QString &key);
+    void insert(const QString &key, const QJsonArray &block);
+    void clear();
+
+    int maxMegabytes() const;
+    void setMaxMegabytes(int maxMegabytes);
+
+    private:
+    // Costs are held in kilobytes
+    QCache<QString, QJsonArray> cache_;
+
+    private:
+    static int cost(const QJsonArray &block);
+};
+
+#endif // DATACACHE_H
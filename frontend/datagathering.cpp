@@ -156,6 +156,7 @@ void MainWindow::handle_result_cycles(HttpRequestWorker *worker)
         ui_->runDataTable->resizeColumnsToContents();
         updateSearch(searchString_);
         ui_->filterBox->clear();
+        watchLocalSource();
         emit tableFilled();
     }
     else
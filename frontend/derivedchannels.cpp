@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "derivedchannels.h"
+#include <QtConcurrent>
+#include <algorithm>
+
+DerivedChannels::DerivedChannels(QObject *parent) : QObject(parent) { setObjectName("derivedChannels"); }
+
+void DerivedChannels::addSeries(const QVector<LogSeries> &series)
+{
+    for (const auto &logSeries : series)
+    {
+        if (!series_.contains(logSeries.run))
+            runs_.append(logSeries.run);
+        auto &held = series_[logSeries.run];
+        if (logSeries.tileLevels > 0 && held.contains(logSeries.field) && held[logSeries.field].tileLevels == 0)
+            continue;
+        held[logSeries.field] = logSeries;
+    }
+}
+
+bool DerivedChannels::holdsSeries() const { return !series_.isEmpty(); }
+
+qint64 DerivedChannels::memoryUsage(QSet<const void *> &counted) const
+{
+    qint64 bytes = 0;
+    for (const auto &fields : series_)
+        for (const auto &logSeries : fields)
+            if (!counted.contains(logSeries.data.data()))
+            {
+                counted.insert(logSeries.data.data());
+                bytes += logSeries.data->memoryUsage();
+            }
+    return bytes;
+}
+
+bool DerivedChannels::addExpression(const QString &text, QString &error)
+{
+    LogExpression expression;
+    if (!expression.parse(text, error))
+        return false;
+    expressions_.append(expression);
+    evaluated_.append(QSet<QString>());
+    return true;
+}
+
+QVector<LogSeries> DerivedChannels::update()
+{
+    // Pair each expression with the runs that now have all its fields
+    QVector<QPair<int, QString>> tasks;
+    for (auto i = 0; i < expressions_.size(); ++i)
+        for (const auto &run : runs_)
+        {
+            if (evaluated_[i].contains(run))
+                continue;
+            auto fields = series_.value(run);
+            auto needed = expressions_[i].fields();
+            auto complete = std::all_of(needed.cbegin(), needed.cend(), [&fields](const QString &field) {
+                return fields.contains(field) && fields[field].tileLevels == 0;
+            });
+            if (!complete)
+                continue;
+            evaluated_[i].insert(run);
+            tasks.append({i, run});
+        }
+    if (tasks.isEmpty())
+        return {};
+
+    // Workers only read the recorded series
+    const auto &series = series_;
+    const auto &expressions = expressions_;
+    auto results = QtConcurrent::blockingMapped<QVector<LogSeries>>(tasks, [&](const QPair<int, QString> &task) {
+        const auto &expression = expressions[task.first];
+        auto runSeries = series.value(task.second);
+        QHash<QString, QSharedPointer<SeriesBuffer>> fields;
+        for (const auto &field : expression.fields())
+            fields.insert(field, runSeries.value(field).data);
+        auto derived = runSeries.value(expression.fields().first());
+        derived.run = task.second + " (" + expression.text() + ")";
+        derived.field = expression.text();
+        derived.data = expression.evaluate(fields);
+        return derived;
+    });
+    results.erase(std::remove_if(results.begin(), results.end(),
+                                 [](const LogSeries &derived) { return derived.data->size() == 0; }),
+                  results.end());
+    return results;
+}
+
+QVector<QPair<QString, QString>> DerivedChannels::samplesNeeded() const
+{
+    QVector<QPair<QString, QString>> needed;
+    for (auto i = 0; i < expressions_.size(); ++i)
+        for (const auto &run : runs_)
+        {
+            if (evaluated_[i].contains(run))
+                continue;
+            auto fields = series_.value(run);
+            for (const auto &field : expressions_[i].fields())
+                if (fields.contains(field) && fields[field].tileLevels > 0 && !needed.contains({run, field}))
+                    needed.append({run, field});
+        }
+    return needed;
+}
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef DERIVEDCHANNELS_H
+#define DERIVEDCHANNELS_H
+
+#include "logdata.h"
+#include "logexpression.h"
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+// Channels of a log window computed by expressions from its fields. Each expression is evaluated once per run, as
+// soon as that run has every field it reads, so adding runs or fields only computes what is new. Fields drawn from
+// level of detail tiles hold min/max pairs rather than samples, so wait for their whole logs
+class DerivedChannels : public QObject
+{
+    Q_OBJECT
+
+    public:
+    DerivedChannels(QObject *parent = nullptr);
+
+    // Record series as they arrive, keeping whole logs over tiles of them
+    void addSeries(const QVector<LogSeries> &series);
+    // Add an expression, returning false with a description of the problem if it cannot be parsed
+    bool addExpression(const QString &text, QString &error);
+    // Series of each expression for runs it can now be evaluated for but has not been, computed in parallel
+    QVector<LogSeries> update();
+    // Runs and fields whose whole logs expressions are waiting for
+    QVector<QPair<QString, QString>> samplesNeeded() const;
+    // Whether series are held, and the heap they take that is not already counted
+    bool holdsSeries() const;
+    qint64 memoryUsage(QSet<const void *> &counted) const;
+
+    private:
+    // Runs in order of arrival, and their series by field name
+    QStringList runs_;
+    QHash<QString, QHash<QString, LogSeries>> series_;
+    QVector<LogExpression> expressions_;
+    // Runs each expression has been evaluated for
+    QVector<QSet<QString>> evaluated_;
+};
+
+#endif // DERIVEDCHANNELS_H
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "detectorcounts.h"
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+
+bool DetectorCounts::fromBinary(const QByteArray &data)
+{
+    // Spectra and bins (int32), bin boundaries (float64) then counts (float32), all little endian
+    qint32 dimensions[2];
+    if (data.size() < (qint64)sizeof(dimensions))
+        return false;
+    std::memcpy(dimensions, data.constData(), sizeof(dimensions));
+    auto timeOfFlightBytes = qint64(dimensions[1] + 1) * sizeof(double);
+    auto countBytes = qint64(dimensions[0]) * dimensions[1] * sizeof(float);
+    if (dimensions[0] < 1 || dimensions[1] < 1 ||
+        data.size() != (qint64)sizeof(dimensions) + timeOfFlightBytes + countBytes)
+        return false;
+
+    spectra = dimensions[0];
+    bins = dimensions[1];
+    timeOfFlight.resize(bins + 1);
+    std::memcpy(timeOfFlight.data(), data.constData() + sizeof(dimensions), timeOfFlightBytes);
+    counts.resize(qint64(spectra) * bins);
+    std::memcpy(counts.data(), data.constData() + sizeof(dimensions) + timeOfFlightBytes, countBytes);
+    return true;
+}
+
+QVector<double> DetectorCounts::summed() const
+{
+    // A few blocks per thread so uneven progress balances out
+    auto blockSize = std::max(spectra / (QThread::idealThreadCount() * 4), 1);
+    QVector<int> blockStarts;
+    for (auto start = 0; start < spectra; start += blockSize)
+        blockStarts.append(start);
+
+    auto sumBlock = [=](int start) {
+        QVector<double> sum(bins, 0.0);
+        auto *total = sum.data();
+        for (auto spectrum = start; spectrum < std::min(start + blockSize, spectra); ++spectrum)
+        {
+            const auto *row = counts.constData() + qint64(spectrum) * bins;
+            for (auto bin = 0; bin < bins; ++bin)
+                total[bin] += row[bin];
+        }
+        return sum;
+    };
+    auto addBlock = [](QVector<double> &total, const QVector<double> &block) {
+        if (total.isEmpty())
+            total = block;
+        else
+            for (auto bin = 0; bin < total.size(); ++bin)
+                total[bin] += block[bin];
+    };
+    return QtConcurrent::blockingMappedReduced<QVector<double>>(blockStarts, sumBlock, addBlock,
+                                                                QtConcurrent::OrderedReduce);
+}
@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef DETECTORCOUNTS_H
+#define DETECTORCOUNTS_H
+
+#include <QByteArray>
+#include <QVector>
+
+// Counts of a range of detector spectra of one run, as sent by /getDetectorCounts
+class DetectorCounts
+{
+    public:
+    int spectra = 0;
+    int bins = 0;
+    // Bin boundaries (bins + 1)
+    QVector<double> timeOfFlight;
+    // Row (spectrum) major
+    QVector<float> counts;
+
+    // Read a binary response, returning false if it is malformed
+    bool fromBinary(const QByteArray &data);
+    // Per bin sum over all spectra, computed over blocks of spectra in parallel
+    QVector<double> summed() const;
+};
+
+#endif // DETECTORCOUNTS_H
@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "envelope.h"
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Envelope::Envelope(double lowerFraction, double upperFraction, double outlierThreshold)
+    : lowerFraction_(lowerFraction), upperFraction_(upperFraction), outlierThreshold_(outlierThreshold)
+{
+}
+
+QVector<double> Envelope::grid(const QVector<Member> &members, int maxPoints)
+{
+    QVector<double> points;
+    auto first = std::numeric_limits<double>::max();
+    auto last = std::numeric_limits<double>::lowest();
+    const Member *densest = nullptr;
+    for (const auto &member : members)
+    {
+        if (member.data->size() == 0)
+            continue;
+        first = std::min(first, member.data->x(0) * member.xScale + member.xOffset);
+        last = std::max(last, member.data->x(member.data->size() - 1) * member.xScale + member.xOffset);
+        if (!densest || member.data->size() > densest->data->size())
+            densest = &member;
+    }
+    if (!densest || last < first)
+        return points;
+
+    // Matching binnings (the usual case for spectra) then resample exactly
+    if (densest->data->size() <= maxPoints)
+    {
+        points.resize(densest->data->size());
+        for (auto i = 0; i < points.size(); ++i)
+            points[i] = densest->data->x(i) * densest->xScale + densest->xOffset;
+        return points;
+    }
+    points.resize(maxPoints);
+    auto step = maxPoints > 1 ? (last - first) / (maxPoints - 1) : 0.0;
+    for (auto i = 0; i < maxPoints; ++i)
+        points[i] = first + i * step;
+    return points;
+}
+
+QVector<double> Envelope::resample(const Member &member, const QVector<double> &grid)
+{
+    QVector<double> values(grid.size(), std::numeric_limits<double>::quiet_NaN());
+    const auto &data = *member.data;
+    if (data.size() == 0)
+        return values;
+
+    // Both are sorted, so a single merge walk finds the samples either side of each grid point
+    auto step = data.interpolation() == SeriesBuffer::Step;
+    auto lastX = data.x(data.size() - 1);
+    auto sample = 0;
+    for (auto i = 0; i < grid.size(); ++i)
+    {
+        auto x = (grid[i] - member.xOffset) / member.xScale;
+        if (x < data.x(0) || x > lastX)
+            continue;
+        while (sample < data.size() - 1 && data.x(sample + 1) <= x)
+            ++sample;
+        if (step || sample == data.size() - 1 || data.x(sample + 1) == data.x(sample))
+            values[i] = data.y(sample);
+        else
+        {
+            auto fraction = (x - data.x(sample)) / (data.x(sample + 1) - data.x(sample));
+            values[i] = data.y(sample) + fraction * (data.y(sample + 1) - data.y(sample));
+        }
+    }
+    return values;
+}
+
+void Envelope::compute(const QVector<Member> &members, int maxPoints)
+{
+    x.clear();
+    mean.clear();
+    min.clear();
+    max.clear();
+    lower.clear();
+    upper.clear();
+    outliers.clear();
+
+    auto points = grid(members, maxPoints);
+    if (points.isEmpty())
+        return;
+    auto rows = QtConcurrent::blockingMapped<QVector<QVector<double>>>(
+        members, [&points](const Member &member) { return resample(member, points); });
+
+    // Reduce blocks of grid points in parallel, a few per thread so uneven progress balances out. Outputs are
+    // written in place, so are sized (and detached) before any worker starts
+    auto size = (int)points.size();
+    QVector<double> median(size);
+    for (auto *values : {&mean, &min, &max, &lower, &upper})
+        values->resize(size);
+    auto *meanData = mean.data();
+    auto *minData = min.data();
+    auto *maxData = max.data();
+    auto *lowerData = lower.data();
+    auto *upperData = upper.data();
+    auto *medianData = median.data();
+    auto blockSize = std::max(size / (QThread::idealThreadCount() * 4), 1);
+    QVector<int> blockStarts;
+    for (auto start = 0; start < size; start += blockSize)
+        blockStarts.append(start);
+    QtConcurrent::blockingMap(blockStarts, [&](const int &start) {
+        QVector<double> column;
+        column.reserve(rows.size());
+        for (auto i = start; i < std::min(start + blockSize, size); ++i)
+        {
+            column.clear();
+            auto sum = 0.0;
+            for (const auto &row : rows)
+                if (!std::isnan(row[i]))
+                {
+                    column.append(row[i]);
+                    sum += row[i];
+                }
+            if (column.isEmpty())
+            {
+                meanData[i] = std::numeric_limits<double>::quiet_NaN();
+                continue;
+            }
+            auto nth = [&](double fraction) {
+                auto it = column.begin() + std::lround(fraction * (column.size() - 1));
+                std::nth_element(column.begin(), it, column.end());
+                return *it;
+            };
+            meanData[i] = sum / column.size();
+            auto range = std::minmax_element(column.cbegin(), column.cend());
+            minData[i] = *range.first;
+            maxData[i] = *range.second;
+            lowerData[i] = nth(lowerFraction_);
+            upperData[i] = nth(upperFraction_);
+            medianData[i] = nth(0.5);
+        }
+    });
+
+    // Score each member by its mean distance from the median, in widths of the percentile band where it has one
+    if (members.size() > 2)
+        for (auto member = 0; member < rows.size(); ++member)
+        {
+            auto distance = 0.0;
+            auto count = 0;
+            for (auto i = 0; i < size; ++i)
+            {
+                auto width = upper[i] - lower[i];
+                if (std::isnan(rows[member][i]) || std::isnan(mean[i]) || width <= 0.0)
+                    continue;
+                distance += std::fabs(rows[member][i] - median[i]) / width;
+                ++count;
+            }
+            if (count > 0 && distance / count > outlierThreshold_)
+                outliers.append(member);
+        }
+
+    // Drop grid points no member covers
+    x = points;
+    auto kept = 0;
+    for (auto i = 0; i < size; ++i)
+    {
+        if (std::isnan(mean[i]))
+            continue;
+        x[kept] = x[i];
+        mean[kept] = mean[i];
+        min[kept] = min[i];
+        max[kept] = max[i];
+        lower[kept] = lower[i];
+        upper[kept] = upper[i];
+        ++kept;
+    }
+    for (auto *values : {&x, &mean, &min, &max, &lower, &upper})
+        values->resize(kept);
+}
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include "seriesbuffer.h"
+#include <QSharedPointer>
+#include <QVector>
+
+// Statistics of many overlaid series, resampled onto a common x grid, so that comparisons of many runs read as a
+// mean within min/max and percentile bands at a cost independent of the number of runs
+class Envelope
+{
+    public:
+    Envelope(double lowerFraction = 0.1, double upperFraction = 0.9, double outlierThreshold = 1.0);
+
+    // A series and the x transform it is shown with
+    struct Member
+    {
+        QSharedPointer<SeriesBuffer> data;
+        double xScale;
+        double xOffset;
+    };
+
+    // Grid in displayed x, and per point statistics over the members covering it
+    QVector<double> x;
+    QVector<double> mean;
+    QVector<double> min;
+    QVector<double> max;
+    QVector<double> lower;
+    QVector<double> upper;
+    // Members straying from the median by more than the outlier threshold, in widths of the percentile band
+    QVector<int> outliers;
+
+    // Resample the members onto a grid of at most maxPoints in parallel, then reduce them point by point
+    void compute(const QVector<Member> &members, int maxPoints);
+
+    private:
+    double lowerFraction_;
+    double upperFraction_;
+    double outlierThreshold_;
+
+    // Grid shared by the members: the samples of the densest one where few enough, else evenly spaced
+    static QVector<double> grid(const QVector<Member> &members, int maxPoints);
+    // Member values at each grid point, NaN outside its range
+    static QVector<double> resample(const Member &member, const QVector<double> &grid);
+};
+
+#endif // ENVELOPE_H
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "flightpath.h"
+#include <algorithm>
+#include <cmath>
+
+// Planck constant over neutron mass, in Å m / µs
+const double HOverNeutronMass = 3.956034e-3;
+// Half the neutron mass, in meV µs² / m²
+const double HalfNeutronMass = 5.227037e6;
+// Half of two theta, in radians per degree
+const double HalfAngleToRadians = 3.14159265358979323846 / 360.0;
+
+bool FlightPath::fromJson(const QJsonArray &block)
+{
+    if (block.size() != 3)
+        return false;
+    l1 = block[0].toDouble();
+    l2 = block[1].toDouble();
+    twoTheta = block[2].toDouble();
+    return true;
+}
+
+bool FlightPath::canConvert(Unit unit) const
+{
+    if (unit == TimeOfFlight)
+        return true;
+    if (l1 + l2 <= 0.0)
+        return false;
+    return unit != DSpacing || std::sin(twoTheta * HalfAngleToRadians) > 0.0;
+}
+
+bool FlightPath::isLinear(Unit unit) { return unit != Energy; }
+
+double FlightPath::scale(Unit unit) const
+{
+    switch (unit)
+    {
+        case Wavelength:
+            return HOverNeutronMass / (l1 + l2);
+        case DSpacing:
+            return HOverNeutronMass / (l1 + l2) / (2.0 * std::sin(twoTheta * HalfAngleToRadians));
+        default:
+            return 1.0;
+    }
+}
+
+void FlightPath::convert(Unit unit, QVector<double> &x, QVector<double> &y) const
+{
+    if (isLinear(unit))
+    {
+        auto factor = scale(unit);
+        for (auto &value : x)
+            value *= factor;
+        return;
+    }
+
+    // Energy falls with time of flight and is unbounded at zero, so drop non-positive times and reverse
+    auto first = std::upper_bound(x.cbegin(), x.cend(), 0.0) - x.cbegin();
+    x.remove(0, first);
+    y.remove(0, first);
+    auto pathSquared = (l1 + l2) * (l1 + l2) * HalfNeutronMass;
+    auto *values = x.data();
+    for (auto i = 0; i < x.size(); ++i)
+        values[i] = pathSquared / (values[i] * values[i]);
+    std::reverse(x.begin(), x.end());
+    std::reverse(y.begin(), y.end());
+}
+
+QString FlightPath::axisTitle(Unit unit)
+{
+    switch (unit)
+    {
+        case Wavelength:
+            return "Wavelength, &#8491;";
+        case DSpacing:
+            return "d-spacing, &#8491;";
+        case Energy:
+            return "Energy, meV";
+        default:
+            return "Time of flight, &#181;s";
+    }
+}
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef FLIGHTPATH_H
+#define FLIGHTPATH_H
+
+#include <QJsonArray>
+#include <QString>
+#include <QVector>
+
+// Neutron flight path to one spectrum, converting time of flight to other x units
+class FlightPath
+{
+    public:
+    // Units in the order of the unit options
+    enum Unit
+    {
+        TimeOfFlight,
+        Wavelength,
+        DSpacing,
+        Energy
+    };
+    // Moderator to sample and sample to detector distances (m), and scattering angle (degrees)
+    double l1 = 0.0;
+    double l2 = 0.0;
+    double twoTheta = 0.0;
+
+    // Read a /getFlightPaths block, returning false if it is malformed
+    bool fromJson(const QJsonArray &block);
+    bool canConvert(Unit unit) const;
+    // Whether a unit is a fixed multiple of time of flight, so can be shown through a view transform alone
+    static bool isLinear(Unit unit);
+    // Multiple of time of flight (µs) giving a linear unit
+    double scale(Unit unit) const;
+    // Convert ascending times of flight (µs) to a nonlinear unit, reordering values so both still ascend
+    void convert(Unit unit, QVector<double> &x, QVector<double> &y) const;
+    static QString axisTitle(Unit unit);
+};
+
+#endif // FLIGHTPATH_H
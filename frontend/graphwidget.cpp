@@ -5,14 +5,24 @@
 #include "./ui_graphwidget.h"
 #include "chartview.h"
 #include "mainwindow.h"
+#include "peakfinder.h"
+#include "rebin.h"
 #include <QChart>
 #include <QChartView>
+#include <QDataStream>
 #include <QDateTime>
 #include <QDebug>
 #include <QInputDialog>
 #include <QJsonArray>
+#include <QKeySequence>
+#include <QLegendMarker>
+#include <QLineSeries>
+#include <QShortcut>
 #include <QValueAxis>
 #include <QXYSeries>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 GraphWidget::GraphWidget(QWidget *parent, QChart *chart, QString type) : QWidget(parent), ui_(new Ui::GraphWidget)
 {
@@ -24,7 +34,41 @@ GraphWidget::GraphWidget(QWidget *parent, QChart *chart, QString type) : QWidget
     connect(ui_->divideByMonitorSpin, &QSpinBox::editingFinished, [=]() { monDivideSpinHandling(); });
     connect(ui_->divideByMonitorRadio, &QRadioButton::toggled, [=]() { monDivideSpinHandling(); });
 
+    // Spectrum browser, shown once the number of spectra is known
+    ui_->SpectrumBrowser->hide();
+    spectrumCount_ = 0;
+    requestedSpectrum_ = -1;
+    connect(ui_->spectrumSlider, &QSlider::valueChanged, ui_->spectrumSpin, &QSpinBox::setValue);
+    connect(ui_->spectrumSpin, QOverload<int>::of(&QSpinBox::valueChanged), ui_->spectrumSlider, &QSlider::setValue);
+    connect(ui_->spectrumSpin, QOverload<int>::of(&QSpinBox::valueChanged), [=](int spectrum) {
+        if (spectrum == requestedSpectrum_)
+            return;
+        requestedSpectrum_ = spectrum;
+        emit spectrumRequested(chartRuns_, spectrum);
+    });
+    // Step through spectra from anywhere in the widget (the chart view would otherwise take page keys to scroll)
+    auto *nextSpectrum = new QShortcut(QKeySequence(Qt::Key_PageUp), this);
+    auto *previousSpectrum = new QShortcut(QKeySequence(Qt::Key_PageDown), this);
+    nextSpectrum->setContext(Qt::WidgetWithChildrenShortcut);
+    previousSpectrum->setContext(Qt::WidgetWithChildrenShortcut);
+    connect(nextSpectrum, &QShortcut::activated, [=]() { ui_->spectrumSpin->stepUp(); });
+    connect(previousSpectrum, &QShortcut::activated, [=]() { ui_->spectrumSpin->stepDown(); });
+
+    ui_->binningSpin->hide();
+    connect(ui_->binningCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &GraphWidget::binningChanged);
+    connect(ui_->binningSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged), [=]() { applyNormalisation(); });
+    connect(ui_->unitCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &GraphWidget::unitChanged);
+    ui_->peakTable->hide();
+    connect(ui_->findPeaksCheck, &QCheckBox::toggled, [=]() { applyNormalisation(); });
+    connect(ui_->peakThresholdSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged), [=]() { applyNormalisation(); });
+    auto setEnvelope = [=]() {
+        ui_->chartView->setEnvelope(ui_->envelopeCheck->isChecked(), ui_->outliersCheck->isChecked());
+    };
+    connect(ui_->envelopeCheck, &QCheckBox::toggled, setEnvelope);
+    connect(ui_->outliersCheck, &QCheckBox::toggled, setEnvelope);
+
     modified_ = "-1";
+    perMicrosecond_ = false;
     ui_->divideByRunSpin->setSpecialValueText(tr(" "));
     ui_->divideByMonitorSpin->setSpecialValueText(tr(" "));
     ui_->divideByRunSpin->setValue(-1);
@@ -35,34 +79,422 @@ GraphWidget::~GraphWidget() {}
 
 QString GraphWidget::getChartRuns() { return chartRuns_; }
 QString GraphWidget::getChartDetector() { return chartDetector_; }
-QJsonArray GraphWidget::getChartData() { return chartData_; }
 
 void GraphWidget::setChartRuns(QString chartRuns) { chartRuns_ = chartRuns; }
 void GraphWidget::setChartDetector(QString chartDetector) { chartDetector_ = chartDetector; }
 void GraphWidget::setChartData(QJsonArray chartData)
 {
-    chartData_ = chartData;
-    getBinWidths();
+    hibernated_.clear();
+    boundaries_.clear();
+    counts_.clear();
+    auto runs = chartRuns_.split(";");
+    auto *chart = ui_->chartView->chart();
+    // Series (and the current zoom) are kept when switching spectra
+    auto existingSeries = series_.count() == chartData.count();
+    for (auto i = 0; i < chartData.count(); ++i)
+    {
+        QVector<double> boundaries;
+        QVector<double> counts;
+        readBins(chartData[i].toArray(), boundaries, counts);
+        boundaries_.append(boundaries);
+        counts_.append(counts);
+
+        if (existingSeries)
+            continue;
+        auto *series = new QLineSeries();
+        series->setName(runs.value(i));
+        chart->addSeries(series);
+        series_.append(series);
+    }
+    if (!existingSeries)
+    {
+        chart->createDefaultAxes();
+        // Default axes cover the series' (still empty) points, so set the horizontal range from the bin centres
+        auto minX = std::numeric_limits<double>::max();
+        auto maxX = std::numeric_limits<double>::lowest();
+        for (const auto &boundaries : boundaries_)
+        {
+            if (boundaries.isEmpty())
+                continue;
+            minX = std::min(minX, boundaries.first());
+            maxX = std::max(maxX, boundaries.last());
+        }
+        if (minX < maxX)
+            chart->axes(Qt::Horizontal)[0]->setRange(minX, maxX);
+    }
+    applyNormalisation();
+}
+
+void GraphWidget::readBins(QJsonArray block, QVector<double> &boundaries, QVector<double> &counts)
+{
+    boundaries.reserve(block.count());
+    counts.reserve(block.count());
+    for (auto j = 0; j < block.count(); j++)
+    {
+        boundaries.append(block.at(j)[0].toDouble());
+        if (j < block.count() - 1)
+            counts.append(block.at(j)[1].toDouble());
+    }
+}
+
+int GraphWidget::getSpectrumCount() { return spectrumCount_; }
+
+void GraphWidget::setSpectrumCount(int spectrumCount)
+{
+    spectrumCount_ = spectrumCount;
+    requestedSpectrum_ = chartDetector_.toInt();
+    ui_->spectrumSlider->blockSignals(true);
+    ui_->spectrumSpin->blockSignals(true);
+    ui_->spectrumSlider->setRange(0, spectrumCount - 1);
+    ui_->spectrumSpin->setRange(0, spectrumCount - 1);
+    ui_->spectrumSlider->setValue(requestedSpectrum_);
+    ui_->spectrumSpin->setValue(requestedSpectrum_);
+    ui_->spectrumSlider->blockSignals(false);
+    ui_->spectrumSpin->blockSignals(false);
+    ui_->SpectrumBrowser->setVisible(spectrumCount > 1);
+}
+
+// Redraw in place with a newly fetched spectrum, unless the browser has since moved on
+void GraphWidget::showSpectrum(int spectrum, QJsonArray chartData)
+{
+    if (spectrum != requestedSpectrum_)
+        return;
+    setChartDetector(QString::number(spectrum));
+    setChartData(chartData);
+
+    // Run divisors are per spectrum, so fetch the one matching
+    if (type_ == "Detector" && modified_ != "-1" && ui_->divideByRunSpin->isEnabled())
+    {
+        emit runDivide(chartDetector_, modified_, false);
+        emit runDivide(chartDetector_, modified_, true);
+    }
+    // As are flight paths; those of the previous spectrum are shown until they arrive
+    if (ui_->unitCombo->currentIndex() != FlightPath::TimeOfFlight)
+        emit flightPaths(type_, chartRuns_, chartDetector_);
 }
+
+void GraphWidget::setFlightPaths(QString spectrum, QJsonArray blocks)
+{
+    if (spectrum != chartDetector_)
+        return;
+    QVector<FlightPath> flightPaths;
+    for (const auto &block : blocks)
+    {
+        FlightPath flightPath;
+        if (!flightPath.fromJson(block.toArray()))
+            return;
+        flightPaths.append(flightPath);
+    }
+    // Keep the zoom when only the spectrum has changed
+    auto resetRange = flightPaths_.isEmpty();
+    flightPaths_ = flightPaths;
+    unitBuffers_.clear();
+    showUnit(resetRange);
+}
+
 void GraphWidget::setLabel(QString label) // Use for presenting spectra information
 {
     return; // ui_->statusLabel->setText(label);
 }
 
-void GraphWidget::getBinWidths()
+QVector<double> GraphWidget::displayBoundaries(int run) const
+{
+    const auto &boundaries = boundaries_[run];
+    if (boundaries.size() < 2)
+        return boundaries;
+    auto parameter = ui_->binningSpin->value();
+    switch (ui_->binningCombo->currentIndex())
+    {
+        case LinearBinning:
+            return Rebin::linear(boundaries.first(), boundaries.last(), parameter);
+        case LogarithmicBinning:
+        {
+            // Logarithmic bins start from the first positive boundary
+            auto start = std::upper_bound(boundaries.cbegin(), boundaries.cend(), 0.0);
+            if (start == boundaries.cend() - 1 || start == boundaries.cend())
+                return boundaries;
+            return Rebin::logarithmic(*start, boundaries.last(), parameter);
+        }
+        case MatchFirstRun:
+            return boundaries_.first();
+        case MatchDivisor:
+            if (!divisorBoundaries_.isEmpty())
+                return divisorBoundaries_[std::min(run, (int)divisorBoundaries_.size() - 1)];
+            return boundaries;
+        default:
+            return boundaries;
+    }
+}
+
+void GraphWidget::applyNormalisation()
+{
+    auto *chart = ui_->chartView->chart();
+    if (series_.count() != counts_.count() || chart->axes(Qt::Vertical).isEmpty())
+        return;
+
+    // Peaks are found in counts, before normalisation, so their significance against a Poisson background holds
+    PeakFinder peakFinder(3, 50, ui_->peakThresholdSpin->value());
+    buffers_.clear();
+    peakBuffers_.clear();
+    auto min = std::numeric_limits<double>::max();
+    auto max = std::numeric_limits<double>::lowest();
+    for (auto i = 0; i < counts_.count(); ++i)
+    {
+        auto boundaries = displayBoundaries(i);
+        auto values = boundaries == boundaries_[i] ? counts_[i] : Rebin::counts(boundaries_[i], counts_[i], boundaries);
+        auto size = values.size();
+        QVector<double> binCentres(size);
+        QVector<double> binWidths(size);
+        const auto *x = boundaries.constData();
+        auto *centres = binCentres.data();
+        auto *widths = binWidths.data();
+        for (auto j = 0; j < size; ++j)
+        {
+            widths[j] = x[j + 1] - x[j];
+            centres[j] = x[j] + widths[j] / 2;
+        }
+
+        QVector<PeakFinder::Peak> peaks;
+        if (ui_->findPeaksCheck->isChecked())
+            peaks = peakFinder.find(values);
+
+        // Each stage is a branch free loop over contiguous arrays so the compiler can vectorise it
+        auto *y = values.data();
+        if (perMicrosecond_)
+        {
+            for (auto j = 0; j < size; ++j)
+                y[j] /= widths[j];
+        }
+        if (!muAmps_.isEmpty())
+        {
+            auto scale = 1.0 / muAmps_[std::min(i, (int)muAmps_.size() - 1)];
+            for (auto j = 0; j < size; ++j)
+                y[j] *= scale;
+        }
+        if (!divisors_.isEmpty())
+        {
+            // Divide within matching bins, whatever binning the divisor was recorded with. Bins with nothing to
+            // divide by are left as they are
+            auto index = std::min(i, (int)divisors_.size() - 1);
+            auto divisor = divisorBoundaries_[index] == boundaries
+                               ? divisors_[index]
+                               : Rebin::counts(divisorBoundaries_[index], divisors_[index], boundaries);
+            const auto *d = divisor.constData();
+            for (auto j = 0; j < size; ++j)
+                y[j] = d[j] != 0.0 ? y[j] / d[j] : y[j];
+        }
+
+        auto buffer = QSharedPointer<SeriesBuffer>::create(binCentres, values);
+        if (buffer->size() > 0)
+        {
+            min = std::min(min, buffer->minY());
+            max = std::max(max, buffer->maxY());
+        }
+        buffers_.append(buffer);
+
+        if (ui_->findPeaksCheck->isChecked())
+        {
+            QVector<double> peakX;
+            QVector<double> peakY;
+            for (const auto &peak : peaks)
+            {
+                auto bin = std::min((int)peak.bin, (int)size - 2);
+                peakX.append(centres[bin] + (peak.bin - bin) * (centres[bin + 1] - centres[bin]));
+                peakY.append(y[std::clamp((int)std::lround(peak.bin), 0, (int)size - 1)]);
+            }
+            peakBuffers_.append(QSharedPointer<SeriesBuffer>::create(peakX, peakY));
+        }
+    }
+    unitBuffers_.clear();
+    showUnit(false);
+    if (max < min)
+        return;
+
+    if (fabs(max - min) < 2) // handles flat lines w/ library limitations
+    {
+        max++;
+        min--;
+    }
+    chart->axes(Qt::Vertical)[0]->setRange(min, max);
+}
+
+void GraphWidget::showUnit(bool resetRange)
+{
+    auto *chart = ui_->chartView->chart();
+    if (series_.count() != buffers_.count() || chart->axes(Qt::Horizontal).isEmpty())
+        return;
+
+    // Stay in time of flight until every run's flight path is known, and go back to it if one cannot be converted
+    auto unit = FlightPath::Unit(ui_->unitCombo->currentIndex());
+    auto known = flightPaths_.size() == buffers_.size();
+    if (!known || !std::all_of(flightPaths_.cbegin(), flightPaths_.cend(),
+                               [unit](const FlightPath &flightPath) { return flightPath.canConvert(unit); }))
+    {
+        unit = FlightPath::TimeOfFlight;
+        if (known)
+        {
+            ui_->unitCombo->blockSignals(true);
+            ui_->unitCombo->setCurrentIndex(unit);
+            ui_->unitCombo->blockSignals(false);
+        }
+    }
+
+    // Linear units are drawn from the time of flight data through the view transform; others are converted once
+    if (!FlightPath::isLinear(unit) && !unitBuffers_.contains(unit))
+    {
+        QVector<QSharedPointer<SeriesBuffer>> converted;
+        for (auto i = 0; i < buffers_.count(); ++i)
+        {
+            const auto &buffer = buffers_[i];
+            QVector<double> x(buffer->size());
+            QVector<double> y(buffer->size());
+            for (auto j = 0; j < buffer->size(); ++j)
+            {
+                x[j] = buffer->x(j);
+                y[j] = buffer->y(j);
+            }
+            flightPaths_[i].convert(unit, x, y);
+            converted.append(QSharedPointer<SeriesBuffer>::create(x, y));
+        }
+        unitBuffers_[unit] = converted;
+    }
+
+    auto minX = std::numeric_limits<double>::max();
+    auto maxX = std::numeric_limits<double>::lowest();
+    for (auto i = 0; i < buffers_.count(); ++i)
+    {
+        auto buffer = FlightPath::isLinear(unit) ? buffers_[i] : unitBuffers_[unit][i];
+        auto scale = FlightPath::isLinear(unit) ? flightPaths_.value(i).scale(unit) : 1.0;
+        ui_->chartView->setSeriesData(series_[i], buffer, scale);
+        if (buffer->size() > 0)
+        {
+            minX = std::min(minX, buffer->x(0) * scale);
+            maxX = std::max(maxX, buffer->x(buffer->size() - 1) * scale);
+        }
+    }
+    chart->axes(Qt::Horizontal)[0]->setTitleText(FlightPath::axisTitle(unit));
+    if (resetRange && minX < maxX)
+        chart->axes(Qt::Horizontal)[0]->setRange(minX, maxX);
+    showPeaks(unit);
+}
+
+void GraphWidget::showPeaks(FlightPath::Unit unit)
 {
-    binWidths_.clear();
-    for (auto run : chartData_)
+    auto *chart = ui_->chartView->chart();
+    if (!ui_->findPeaksCheck->isChecked() || peakBuffers_.count() != series_.count())
     {
-        QVector<double> binWidths;
-        auto runArray = run.toArray();
-        for (auto i = 0; i < runArray.count() - 1; i++)
+        for (auto *markers : peakSeries_)
         {
-            double binWidth = runArray.at(i + 1)[0].toDouble() - runArray.at(i)[0].toDouble();
-            binWidths.append(binWidth);
+            chart->removeSeries(markers);
+            delete markers;
         }
-        binWidths_.append(binWidths);
+        peakSeries_.clear();
+        ui_->peakTable->hide();
+        return;
     }
+
+    // Markers share their run's axes and colour, and stay out of the legend
+    while (peakSeries_.count() < series_.count())
+    {
+        auto *series = series_[peakSeries_.count()];
+        auto *markers = new QScatterSeries();
+        markers->setName("Peaks " + series->name());
+        markers->setColor(series->color());
+        markers->setMarkerSize(8);
+        chart->addSeries(markers);
+        for (auto *axis : series->attachedAxes())
+            markers->attachAxis(axis);
+        for (auto *legendMarker : chart->legend()->markers(markers))
+            legendMarker->setVisible(false);
+        peakSeries_.append(markers);
+    }
+
+    ui_->peakTable->setRowCount(0);
+    for (auto i = 0; i < peakBuffers_.count(); ++i)
+    {
+        auto buffer = peakBuffers_[i];
+        auto scale = 1.0;
+        if (FlightPath::isLinear(unit))
+            scale = flightPaths_.value(i).scale(unit);
+        else
+        {
+            QVector<double> x(buffer->size());
+            QVector<double> y(buffer->size());
+            for (auto j = 0; j < buffer->size(); ++j)
+            {
+                x[j] = buffer->x(j);
+                y[j] = buffer->y(j);
+            }
+            flightPaths_[i].convert(unit, x, y);
+            buffer = QSharedPointer<SeriesBuffer>::create(x, y);
+        }
+        ui_->chartView->setSeriesData(peakSeries_[i], buffer, scale);
+
+        for (auto j = 0; j < buffer->size(); ++j)
+        {
+            auto row = ui_->peakTable->rowCount();
+            ui_->peakTable->insertRow(row);
+            ui_->peakTable->setItem(row, 0, new QTableWidgetItem(series_[i]->name()));
+            ui_->peakTable->setItem(row, 1, new QTableWidgetItem(QString::number(buffer->x(j) * scale)));
+            ui_->peakTable->setItem(row, 2, new QTableWidgetItem(QString::number(buffer->y(j))));
+        }
+    }
+    ui_->peakTable->show();
+}
+
+void GraphWidget::hibernate()
+{
+    if (isHibernating() || counts_.isEmpty())
+        return;
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << boundaries_ << counts_ << divisorBoundaries_ << divisors_;
+    hibernated_ = qCompress(data, 1);
+
+    boundaries_.clear();
+    counts_.clear();
+    divisorBoundaries_.clear();
+    divisors_.clear();
+    buffers_.clear();
+    unitBuffers_.clear();
+    peakBuffers_.clear();
+    for (auto *series : series_)
+        ui_->chartView->removeSeriesData(series);
+    for (auto *markers : peakSeries_)
+        ui_->chartView->removeSeriesData(markers);
+}
+
+void GraphWidget::wake()
+{
+    if (!isHibernating())
+        return;
+    QDataStream stream(qUncompress(hibernated_));
+    stream >> boundaries_ >> counts_ >> divisorBoundaries_ >> divisors_;
+    hibernated_.clear();
+    applyNormalisation();
+}
+
+bool GraphWidget::isHibernating() const { return !hibernated_.isEmpty(); }
+
+qint64 GraphWidget::memoryUsage(QSet<const void *> &counted) const
+{
+    qint64 bytes = hibernated_.size();
+    for (const auto *arrays : {&boundaries_, &counts_, &divisorBoundaries_, &divisors_})
+        for (const auto &array : *arrays)
+            bytes += array.capacity() * (qint64)sizeof(double);
+    auto addBuffers = [&](const QVector<QSharedPointer<SeriesBuffer>> &buffers) {
+        for (const auto &buffer : buffers)
+            if (!counted.contains(buffer.data()))
+            {
+                counted.insert(buffer.data());
+                bytes += buffer->memoryUsage();
+            }
+    };
+    addBuffers(buffers_);
+    addBuffers(peakBuffers_);
+    for (const auto &buffers : unitBuffers_)
+        addBuffers(buffers);
+    return bytes + ui_->chartView->memoryUsage(counted);
 }
 
 ChartView *GraphWidget::getChartView() { return ui_->chartView; }
@@ -146,62 +578,15 @@ void GraphWidget::monDivideSpinHandling()
 // normalise against time
 void GraphWidget::on_countsPerMicrosecondCheck_stateChanged(int state)
 {
-    qreal max = 0;
-    qreal min = 0;
     QString modifier = "/microSeconds";
     auto yAxisTitle = ui_->chartView->chart()->axes(Qt::Vertical)[0]->titleText();
-
-    for (auto i = 0; i < ui_->chartView->chart()->series().count(); i++)
-    {
-        auto xySeries = qobject_cast<QXYSeries *>(ui_->chartView->chart()->series()[i]);
-        auto points = xySeries->points();
-        if (state == Qt::Checked)
-        {
-            for (auto j = 0; j < points.count(); j++)
-            {
-                auto hold = points[j].y() / binWidths_[i][j];
-                if (i == 0 && j == 0)
-                {
-                    max = hold;
-                    min = hold;
-                }
-                if (hold > max)
-                    max = hold;
-                else if (hold < min)
-                    min = hold;
-                points[j].setY(hold);
-            }
-            yAxisTitle.append(modifier);
-        }
-        else
-        {
-            for (auto j = 0; j < points.count(); j++)
-            {
-                auto hold = points[j].y() * binWidths_[i][j];
-                if (i == 0 && j == 0)
-                {
-                    max = hold;
-                    min = hold;
-                }
-                if (hold > max)
-                    max = hold;
-                else if (hold < min)
-                    min = hold;
-                points[j].setY(hold);
-            }
-            yAxisTitle.remove(modifier);
-        }
-        ui_->chartView->chart()->axes(Qt::Vertical)[0]->setTitleText(yAxisTitle);
-
-        xySeries->replace(points);
-        if (fabs(max - min) < 2) // handles flat lines w/ library limitations
-        {
-            max++;
-            min--;
-        }
-        ui_->chartView->chart()->axes()[1]->setMax(max);
-        ui_->chartView->chart()->axes()[1]->setMin(min);
-    }
+    perMicrosecond_ = state == Qt::Checked;
+    if (perMicrosecond_)
+        yAxisTitle.append(modifier);
+    else
+        yAxisTitle.remove(modifier);
+    ui_->chartView->chart()->axes(Qt::Vertical)[0]->setTitleText(yAxisTitle);
+    applyNormalisation();
 }
 
 void GraphWidget::on_countsPerMicroAmpCheck_stateChanged(int state)
@@ -212,131 +597,74 @@ void GraphWidget::on_countsPerMicroAmpCheck_stateChanged(int state)
         emit muAmps(chartRuns_, false, modified_);
 }
 
-void GraphWidget::modifyAgainstString(QString values, bool checked)
+// Set the parameter for the chosen binning: a width in µs for linear bins, and dT/T for logarithmic ones
+void GraphWidget::binningChanged(int index)
 {
-    qreal max = 0;
-    qreal min = 0;
-    for (auto i = 0; i < ui_->chartView->chart()->series().count(); i++)
+    ui_->binningSpin->blockSignals(true);
+    if (index == LinearBinning)
     {
-        double val;
-        if (values.split(";").count() > 1)
-            val = values.split(";")[i].toDouble();
-        else
-            val = values.toDouble();
-        if (values.split(";").count() > ui_->chartView->chart()->series().count())
-            val = val / values.split(";").last().toDouble();
-        auto xySeries = qobject_cast<QXYSeries *>(ui_->chartView->chart()->series()[i]);
-        auto points = xySeries->points();
-        if (checked)
-        {
+        ui_->binningSpin->setSuffix(" µs");
+        ui_->binningSpin->setRange(0.01, 100000);
+        ui_->binningSpin->setSingleStep(1);
+        ui_->binningSpin->setValue(10);
+    }
+    else if (index == LogarithmicBinning)
+    {
+        ui_->binningSpin->setSuffix(" dT/T");
+        ui_->binningSpin->setRange(0.0001, 1);
+        ui_->binningSpin->setSingleStep(0.001);
+        ui_->binningSpin->setValue(0.002);
+    }
+    ui_->binningSpin->blockSignals(false);
+    ui_->binningSpin->setVisible(index == LinearBinning || index == LogarithmicBinning);
+    applyNormalisation();
+}
 
-            for (auto j = 0; j < points.count(); j++)
-            {
-                auto hold = points[j].y() / val;
-                if (i == 0 && j == 0)
-                {
-                    max = hold;
-                    min = hold;
-                }
-                if (hold > max)
-                    max = hold;
-                else if (hold < min)
-                    min = hold;
-                points[j].setY(hold);
-            }
-        }
-        else
-        {
-            for (auto j = 0; j < points.count(); j++)
-            {
-                auto hold = points[j].y() * val;
-                if (i == 0 && j == 0)
-                {
-                    max = hold;
-                    min = hold;
-                }
-                if (hold > max)
-                    max = hold;
-                else if (hold < min)
-                    min = hold;
-                points[j].setY(hold);
-            }
-        }
-        xySeries->replace(points);
-        if (fabs(max - min) < 2) // handles flat lines w/ library limitations
+// Flight paths are only fetched once a unit other than time of flight is chosen
+void GraphWidget::unitChanged(int index)
+{
+    if (index != FlightPath::TimeOfFlight && flightPaths_.size() != counts_.size())
+        emit flightPaths(type_, chartRuns_, chartDetector_);
+    else
+        showUnit(true);
+}
+
+// Set (or clear) the per run charge normalisation, relative to that of the divisor run if one is appended
+void GraphWidget::modifyAgainstString(QString values, bool checked)
+{
+    muAmps_.clear();
+    if (checked)
+    {
+        auto valueList = values.split(";");
+        auto seriesCount = series_.count();
+        for (auto i = 0; i < std::min((int)valueList.count(), seriesCount); ++i)
         {
-            max++;
-            min--;
+            auto val = valueList[i].toDouble();
+            if (valueList.count() > seriesCount)
+                val = val / valueList.last().toDouble();
+            muAmps_.append(val);
         }
-        ui_->chartView->chart()->axes()[1]->setMax(max);
-        ui_->chartView->chart()->axes()[1]->setMin(min);
     }
+    applyNormalisation();
 }
 
-void GraphWidget::modifyAgainstWorker(HttpRequestWorker *worker, bool checked)
+// Set (or clear) the per bin run or monitor divisor
+void GraphWidget::modifyAgainstBlocks(QJsonArray blocks, bool checked)
 {
-    QJsonArray valueArray;
-    qreal max = 0;
-    qreal min = 0;
-    auto dataType = worker->jsonArray[0].toArray()[2].toString(0);
-    worker->jsonArray.removeFirst();
-    for (auto i = 0; i < ui_->chartView->chart()->series().count(); i++)
+    // Hibernated divisors would otherwise replace these on waking
+    wake();
+    divisorBoundaries_.clear();
+    divisors_.clear();
+    if (checked)
     {
-        if (worker->jsonArray.count() > 1)
-            valueArray = worker->jsonArray[i].toArray();
-        else
-            valueArray = worker->jsonArray[0].toArray();
-        auto xySeries = qobject_cast<QXYSeries *>(ui_->chartView->chart()->series()[i]);
-        auto points = xySeries->points();
-        if (checked)
+        for (const auto &run : blocks)
         {
-            for (auto j = 0; j < points.count(); j++)
-            {
-                auto val = valueArray.at(j)[1].toDouble();
-                if (val != 0)
-                {
-                    auto hold = points[j].y() / val;
-                    if (i == 0 && j == 0)
-                    {
-                        max = hold;
-                        min = hold;
-                    }
-                    if (hold > max)
-                        max = hold;
-                    else if (hold < min)
-                        min = hold;
-                    points[j].setY(hold);
-                }
-            }
-        }
-        else
-        {
-            for (auto j = 0; j < points.count(); j++)
-            {
-                auto val = valueArray.at(j)[1].toDouble();
-                if (val != 0)
-                {
-                    auto hold = points[j].y() * val;
-                    if (i == 0 && j == 0)
-                    {
-                        max = hold;
-                        min = hold;
-                    }
-                    if (hold > max)
-                        max = hold;
-                    else if (hold < min)
-                        min = hold;
-                    points[j].setY(hold);
-                }
-            }
+            QVector<double> boundaries;
+            QVector<double> divisor;
+            readBins(run.toArray(), boundaries, divisor);
+            divisorBoundaries_.append(boundaries);
+            divisors_.append(divisor);
         }
-        xySeries->replace(points);
-        if (fabs(max - min) < 2) // handles flat lines w/ library limitations
-        {
-            max++;
-            min--;
-        }
-        ui_->chartView->chart()->axes()[1]->setMax(max);
-        ui_->chartView->chart()->axes()[1]->setMin(min);
     }
-}
\ No newline at end of file
+    applyNormalisation();
+}
@@ -5,9 +5,12 @@
 #define GRAPHWIDGET_H
 
 #include "chartview.h"
+#include "flightpath.h"
 #include "httprequestworker.h"
 #include <QChart>
 #include <QChartView>
+#include <QHash>
+#include <QScatterSeries>
 #include <QWidget>
 
 namespace Ui
@@ -21,45 +24,98 @@ class GraphWidget : public QWidget
 
     public:
     GraphWidget(QWidget *parent = nullptr, QChart *chart = nullptr, QString type = nullptr);
+    // Display binnings, in the order of the binning options
+    enum Binning
+    {
+        AsRecorded,
+        LinearBinning,
+        LogarithmicBinning,
+        MatchFirstRun,
+        MatchDivisor
+    };
     ~GraphWidget();
     ChartView *getChartView();
 
     QString getChartRuns();
     QString getChartDetector();
-    QJsonArray getChartData();
 
     void setChartRuns(QString chartRuns);
     void setChartDetector(QString chartDetector);
+    // Store raw run spectra and create their series
     void setChartData(QJsonArray chartData);
     void setLabel(QString label);
+    int getSpectrumCount();
+    // Enable the spectrum browser over the given number of spectra
+    void setSpectrumCount(int spectrumCount);
+    void showSpectrum(int spectrum, QJsonArray chartData);
+    // Set the flight path of each run to the given spectrum, from /getFlightPaths blocks
+    void setFlightPaths(QString spectrum, QJsonArray blocks);
+    // Hold only the raw data, in compressed form, while not shown, and rebuild the plot from it
+    void hibernate();
+    void wake();
+    bool isHibernating() const;
+    // Heap held for raw and display data, in bytes, excluding buffers already counted
+    qint64 memoryUsage(QSet<const void *> &counted) const;
 
     public slots:
     void modifyAgainstString(QString values, bool checked);
-    void modifyAgainstWorker(HttpRequestWorker *worker, bool checked);
+    void modifyAgainstBlocks(QJsonArray blocks, bool checked);
 
     private:
-    void getBinWidths();
+    // Recompute displayed values from the raw counts through the chosen binning and enabled normalisations
+    void applyNormalisation();
+    // Bin boundaries a run is displayed with
+    QVector<double> displayBoundaries(int run) const;
+    // Show the display data in the chosen unit, converting it if the unit is not a multiple of time of flight
+    void showUnit(bool resetRange);
+    // Mark and list found peaks in the unit shown, or remove them if peak finding is off
+    void showPeaks(FlightPath::Unit unit);
+    // Read a block of [bin start, counts] pairs, the last of which only closes the final bin
+    static void readBins(QJsonArray block, QVector<double> &boundaries, QVector<double> &counts);
 
     private slots:
     void runDivideSpinHandling(); // Handle normalisation conflicts
     void monDivideSpinHandling(); // Handle normalisation conflicts
     void on_countsPerMicrosecondCheck_stateChanged(int state);
     void on_countsPerMicroAmpCheck_stateChanged(int state);
+    void binningChanged(int index);
+    void unitChanged(int index);
 
     private:
     Ui::GraphWidget *ui_;
     QString run_;
     QString chartRuns_;
     QString chartDetector_;
-    QJsonArray chartData_;
-    QVector<QVector<double>> binWidths_;
+    // Run data series, in run order
+    QVector<QXYSeries *> series_;
+    // Raw data per run, held contiguously: bin boundaries and counts
+    QVector<QVector<double>> boundaries_;
+    QVector<QVector<double>> counts_;
+    // Enabled normalisations; empty when off. Divisors keep their own binning and are rebinned onto each run
+    bool perMicrosecond_;
+    QVector<double> muAmps_;
+    QVector<QVector<double>> divisorBoundaries_;
+    QVector<QVector<double>> divisors_;
+    // Display data per run against time of flight, and copies converted to nonlinear units as they are first shown
+    QVector<QSharedPointer<SeriesBuffer>> buffers_;
+    QHash<int, QVector<QSharedPointer<SeriesBuffer>>> unitBuffers_;
+    QVector<FlightPath> flightPaths_;
+    // Found peaks per run, as time of flight against displayed value, and their markers
+    QVector<QSharedPointer<SeriesBuffer>> peakBuffers_;
+    QVector<QScatterSeries *> peakSeries_;
+    // Raw data and divisors while hibernating
+    QByteArray hibernated_;
     QString type_;
     QString modified_;
+    int spectrumCount_;
+    int requestedSpectrum_;
 
     signals:
     void muAmps(QString runs, bool checked, QString modified);
     void runDivide(QString currentDetector, QString run, bool checked);
     void monDivide(QString currentRun, QString mon, bool checked);
+    void spectrumRequested(QString runs, int spectrum);
+    void flightPaths(QString type, QString runs, QString spectrum);
 };
 
 #endif
@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "heatmapwidget.h"
+#include "detectorcounts.h"
+#include <QDataStream>
+#include <QFutureWatcher>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QWheelEvent>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Tile edge in level values (and so in image pixels)
+const int TileSize = 256;
+// Tiles held, at 256 kB each
+const int MaxTiles = 256;
+
+HeatmapWidget::HeatmapWidget(QWidget *parent) : QWidget(parent), maxCount_(0.0)
+{
+    tiles_.setMaxCost(MaxTiles);
+    setMouseTracking(true);
+    setMinimumSize(200, 200);
+}
+
+bool HeatmapWidget::setData(const QByteArray &data)
+{
+    DetectorCounts detectorCounts;
+    if (!detectorCounts.fromBinary(data))
+        return false;
+    auto spectra = detectorCounts.spectra;
+    auto bins = detectorCounts.bins;
+    auto counts = detectorCounts.counts;
+    timeOfFlight_ = detectorCounts.timeOfFlight;
+    maxCount_ = *std::max_element(counts.cbegin(), counts.cend());
+    view_ = QRectF(0, 0, bins, spectra);
+    hibernated_.clear();
+    reduce(counts, spectra, bins);
+    return true;
+}
+
+void HeatmapWidget::reduce(QVector<float> counts, int spectra, int bins)
+{
+    auto *watcher = new QFutureWatcher<QSharedPointer<const QVector<Level>>>(this);
+    connect(watcher, &QFutureWatcher<QSharedPointer<const QVector<Level>>>::finished, [=]() {
+        levels_ = watcher->result();
+        tiles_.clear();
+        pendingTiles_.clear();
+        watcher->deleteLater();
+        update();
+    });
+    watcher->setFuture(QtConcurrent::run(&HeatmapWidget::buildLevels, counts, spectra, bins));
+}
+
+int HeatmapWidget::spectrumCount() const { return levels_ ? levels_->first().spectra : 0; }
+
+void HeatmapWidget::hibernate()
+{
+    if (!levels_)
+        return;
+    const auto &full = levels_->first();
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << (qint32)full.spectra << (qint32)full.bins << full.counts;
+    // Detector counts are mostly zeros, so even the fastest compression shrinks them a long way
+    hibernated_ = qCompress(data, 1);
+    levels_.reset();
+    tiles_.clear();
+    pendingTiles_.clear();
+}
+
+void HeatmapWidget::wake()
+{
+    if (!isHibernating())
+        return;
+    qint32 spectra;
+    qint32 bins;
+    QVector<float> counts;
+    QDataStream stream(qUncompress(hibernated_));
+    stream >> spectra >> bins >> counts;
+    hibernated_.clear();
+    reduce(counts, spectra, bins);
+}
+
+bool HeatmapWidget::isHibernating() const { return !hibernated_.isEmpty(); }
+
+qint64 HeatmapWidget::memoryUsage() const
+{
+    qint64 bytes = hibernated_.size() + timeOfFlight_.capacity() * (qint64)sizeof(double);
+    if (levels_)
+        for (const auto &level : *levels_)
+            bytes += level.counts.capacity() * (qint64)sizeof(float);
+    for (auto key : tiles_.keys())
+        bytes += tiles_.object(key)->sizeInBytes();
+    return bytes;
+}
+
+// Halve each level with 2x2 maximum pooling (so isolated hot pixels survive) until it fits a single tile
+QSharedPointer<const QVector<HeatmapWidget::Level>> HeatmapWidget::buildLevels(QVector<float> counts, int spectra,
+                                                                               int bins)
+{
+    auto levels = QSharedPointer<QVector<Level>>::create();
+    levels->append({spectra, bins, counts});
+    while (levels->last().spectra > TileSize || levels->last().bins > TileSize)
+    {
+        const auto &source = levels->last();
+        Level level{(source.spectra + 1) / 2, (source.bins + 1) / 2, QVector<float>()};
+        level.counts.resize(qint64(level.spectra) * level.bins);
+
+        QVector<int> rows(level.spectra);
+        std::iota(rows.begin(), rows.end(), 0);
+        QtConcurrent::blockingMap(rows, [&](int row) {
+            auto *out = level.counts.data() + qint64(row) * level.bins;
+            const auto *upper = source.counts.constData() + qint64(row * 2) * source.bins;
+            const auto *lower = row * 2 + 1 < source.spectra ? upper + source.bins : upper;
+            for (auto bin = 0; bin < level.bins; ++bin)
+            {
+                auto right = std::min(bin * 2 + 1, source.bins - 1);
+                out[bin] = std::max({upper[bin * 2], upper[right], lower[bin * 2], lower[right]});
+            }
+        });
+        levels->append(level);
+    }
+    return levels;
+}
+
+// Colour one tile of a level on a log scale
+QImage HeatmapWidget::renderTile(QSharedPointer<const QVector<Level>> levels, int level, int tileX, int tileY,
+                                 float maxCount)
+{
+    // Dark blue through green to yellow
+    static const QVector<QRgb> colourMap = []() {
+        const QColor stops[] = {QColor(48, 18, 59), QColor(40, 120, 220), QColor(30, 200, 140), QColor(250, 230, 40)};
+        QVector<QRgb> colours(256);
+        for (auto i = 0; i < 256; ++i)
+        {
+            auto position = i / 255.0 * 3;
+            auto stop = std::min(int(position), 2);
+            auto fraction = position - stop;
+            colours[i] = qRgb(stops[stop].red() + fraction * (stops[stop + 1].red() - stops[stop].red()),
+                              stops[stop].green() + fraction * (stops[stop + 1].green() - stops[stop].green()),
+                              stops[stop].blue() + fraction * (stops[stop + 1].blue() - stops[stop].blue()));
+        }
+        return colours;
+    }();
+
+    const auto &data = levels->at(level);
+    auto width = std::min(TileSize, data.bins - tileX * TileSize);
+    auto height = std::min(TileSize, data.spectra - tileY * TileSize);
+    QImage image(width, height, QImage::Format_RGB32);
+    auto scale = 255.0 / std::log1p(std::max(maxCount, 1.0f));
+    for (auto y = 0; y < height; ++y)
+    {
+        const auto *row = data.counts.constData() + qint64(tileY * TileSize + y) * data.bins + tileX * TileSize;
+        auto *pixels = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (auto x = 0; x < width; ++x)
+            pixels[x] = row[x] > 0 ? colourMap[std::min(int(std::log1p(row[x]) * scale), 255)] : qRgb(0, 0, 0);
+    }
+    return image;
+}
+
+int HeatmapWidget::levelForView() const
+{
+    auto valuesPerPixel = std::max(view_.width() / std::max(width(), 1), view_.height() / std::max(height(), 1));
+    auto level = valuesPerPixel > 1 ? int(std::floor(std::log2(valuesPerPixel))) : 0;
+    return std::clamp(level, 0, (int)levels_->size() - 1);
+}
+
+QPointF HeatmapWidget::toData(QPointF position) const
+{
+    return QPointF(view_.left() + position.x() / width() * view_.width(),
+                   view_.top() + position.y() / height() * view_.height());
+}
+
+void HeatmapWidget::requestTile(int level, int tileX, int tileY)
+{
+    quint64 key = (quint64(level) << 48) | (quint64(tileY) << 24) | quint64(tileX);
+    if (pendingTiles_.contains(key))
+        return;
+    pendingTiles_.insert(key);
+
+    auto *watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, &QFutureWatcher<QImage>::finished, [=]() {
+        // Drop tiles from data since replaced
+        if (pendingTiles_.remove(key))
+        {
+            tiles_.insert(key, new QImage(watcher->result()));
+            update();
+        }
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(&HeatmapWidget::renderTile, levels_, level, tileX, tileY, maxCount_));
+}
+
+// Keep the view within the data and no smaller than a few values across
+void HeatmapWidget::clampView()
+{
+    const auto &full = levels_->first();
+    auto width = std::clamp(view_.width(), std::min(8.0, (double)full.bins), (double)full.bins);
+    auto height = std::clamp(view_.height(), std::min(8.0, (double)full.spectra), (double)full.spectra);
+    auto left = std::clamp(view_.left(), 0.0, full.bins - width);
+    auto top = std::clamp(view_.top(), 0.0, full.spectra - height);
+    view_ = QRectF(left, top, width, height);
+}
+
+void HeatmapWidget::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+    if (!levels_)
+    {
+        painter.setPen(Qt::white);
+        painter.drawText(rect(), Qt::AlignCenter, "Reducing detector counts...");
+        return;
+    }
+
+    // Map data coordinates at a level to the widget
+    auto drawLevel = [&](int level) {
+        auto scale = double(1 << level);
+        const auto &data = levels_->at(level);
+        auto firstX = std::max(int(view_.left() / scale) / TileSize, 0);
+        auto lastX = std::min(int(view_.right() / scale) / TileSize, (data.bins - 1) / TileSize);
+        auto firstY = std::max(int(view_.top() / scale) / TileSize, 0);
+        auto lastY = std::min(int(view_.bottom() / scale) / TileSize, (data.spectra - 1) / TileSize);
+        for (auto tileY = firstY; tileY <= lastY; ++tileY)
+            for (auto tileX = firstX; tileX <= lastX; ++tileX)
+            {
+                quint64 key = (quint64(level) << 48) | (quint64(tileY) << 24) | quint64(tileX);
+                auto *image = tiles_.object(key);
+                if (!image)
+                {
+                    requestTile(level, tileX, tileY);
+                    continue;
+                }
+                QRectF tileRect(tileX * TileSize * scale, tileY * TileSize * scale, image->width() * scale,
+                                image->height() * scale);
+                QRectF target((tileRect.left() - view_.left()) / view_.width() * width(),
+                              (tileRect.top() - view_.top()) / view_.height() * height(),
+                              tileRect.width() / view_.width() * width(), tileRect.height() / view_.height() * height());
+                painter.drawImage(target, *image);
+            }
+    };
+
+    // Draw the coarsest level beneath as a placeholder until finer tiles arrive
+    auto level = levelForView();
+    auto coarsest = levels_->size() - 1;
+    if (level != coarsest)
+        drawLevel(coarsest);
+    drawLevel(level);
+
+    painter.setPen(Qt::white);
+    auto firstBin = std::clamp(int(view_.left()), 0, (int)timeOfFlight_.size() - 1);
+    auto lastBin = std::clamp(int(std::ceil(view_.right())), 0, (int)timeOfFlight_.size() - 1);
+    painter.drawText(rect().adjusted(4, 4, -4, -4), Qt::AlignLeft | Qt::AlignTop,
+                     "Spectra " + QString::number(int(view_.top())) + "-" + QString::number(int(view_.bottom()) - 1) +
+                         ", time of flight " + QString::number(timeOfFlight_[firstBin]) + "-" +
+                         QString::number(timeOfFlight_[lastBin]) + " µs");
+}
+
+void HeatmapWidget::wheelEvent(QWheelEvent *event)
+{
+    if (!levels_)
+        return;
+    // Zoom about the cursor
+    auto factor = event->angleDelta().y() > 0 ? 0.8 : 1.25;
+    auto anchor = toData(event->position());
+    view_ = QRectF(anchor.x() - (anchor.x() - view_.left()) * factor, anchor.y() - (anchor.y() - view_.top()) * factor,
+                   view_.width() * factor, view_.height() * factor);
+    clampView();
+    update();
+}
+
+void HeatmapWidget::mousePressEvent(QMouseEvent *event)
+{
+    pressPos_ = event->pos();
+    lastMousePos_ = event->pos();
+    if (event->button() == Qt::RightButton && levels_)
+    {
+        view_ = QRectF(0, 0, levels_->first().bins, levels_->first().spectra);
+        update();
+    }
+}
+
+void HeatmapWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!levels_)
+        return;
+    if (event->buttons() & Qt::LeftButton)
+    {
+        // Pan
+        auto delta = event->pos() - lastMousePos_;
+        view_.translate(-delta.x() * view_.width() / width(), -delta.y() * view_.height() / height());
+        lastMousePos_ = event->pos();
+        clampView();
+        update();
+        return;
+    }
+
+    const auto &full = levels_->first();
+    auto position = toData(event->position());
+    auto bin = std::clamp(int(position.x()), 0, full.bins - 1);
+    auto spectrum = std::clamp(int(position.y()), 0, full.spectra - 1);
+    emit statusChanged("Spectrum " + QString::number(spectrum) + ", " + QString::number(timeOfFlight_[bin]) + " µs: " +
+                       QString::number(full.counts[qint64(spectrum) * full.bins + bin]) + " counts");
+}
+
+void HeatmapWidget::mouseReleaseEvent(QMouseEvent *event)
+{
+    // A click without a drag opens the spectrum under the cursor
+    if (levels_ && event->button() == Qt::LeftButton && (event->pos() - pressPos_).manhattanLength() < 4)
+        emit spectrumClicked(std::clamp(int(toData(event->position()).y()), 0, levels_->first().spectra - 1));
+}
+
+void HeatmapWidget::leaveEvent(QEvent *event) { emit statusChanged(""); }
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef HEATMAPWIDGET_H
+#define HEATMAPWIDGET_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QPoint>
+#include <QRectF>
+#include <QSet>
+#include <QSharedPointer>
+#include <QVector>
+#include <QWidget>
+
+// Detector counts of one run as spectrum index against time of flight, on a log colour scale. Counts are held as a
+// pyramid of successively halved resolutions, drawn from tiles rendered on worker threads
+class HeatmapWidget : public QWidget
+{
+    Q_OBJECT
+
+    public:
+    HeatmapWidget(QWidget *parent = nullptr);
+
+    // Load a /getDetectorCounts response, returning false if it is malformed
+    bool setData(const QByteArray &data);
+    int spectrumCount() const;
+    // Hold only full resolution counts, in compressed form, while not shown, and rebuild the levels from them
+    void hibernate();
+    void wake();
+    bool isHibernating() const;
+    // Heap held for counts and tiles, in bytes
+    qint64 memoryUsage() const;
+
+    signals:
+    void spectrumClicked(int spectrum);
+    void statusChanged(QString message);
+
+    protected:
+    void paintEvent(QPaintEvent *event);
+    void wheelEvent(QWheelEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseMoveEvent(QMouseEvent *event);
+    void mouseReleaseEvent(QMouseEvent *event);
+    void leaveEvent(QEvent *event);
+
+    public:
+    // Counts at one resolution, row (spectrum) major
+    struct Level
+    {
+        int spectra;
+        int bins;
+        QVector<float> counts;
+    };
+
+    private:
+    QSharedPointer<const QVector<Level>> levels_;
+    QVector<double> timeOfFlight_;
+    float maxCount_;
+    // Visible region in (bin, spectrum) coordinates
+    QRectF view_;
+    QCache<quint64, QImage> tiles_;
+    QSet<quint64> pendingTiles_;
+    QPoint pressPos_;
+    QPoint lastMousePos_;
+    // Spectra, bins and full resolution counts while hibernating
+    QByteArray hibernated_;
+
+    private:
+    // Build the levels off the GUI thread, then draw
+    void reduce(QVector<float> counts, int spectra, int bins);
+    static QSharedPointer<const QVector<Level>> buildLevels(QVector<float> counts, int spectra, int bins);
+    static QImage renderTile(QSharedPointer<const QVector<Level>> levels, int level, int tileX, int tileY,
+                             float maxCount);
+    // Finest level with under two values per pixel along both axes, so the tiles in view stay well within MaxTiles
+    int levelForView() const;
+    QPointF toData(QPointF position) const;
+    void requestTile(int level, int tileX, int tileY);
+    void clampView();
+};
+
+#endif // HEATMAPWIDGET_H
@@ -25,6 +25,7 @@ void HttpRequestWorker::execute(HttpRequestInput input)
 
     // reset variables
     response = "";
+    rawResponse.clear();
     errorType = QNetworkReply::NoError;
     errorString = "";
 
@@ -38,7 +39,10 @@ void HttpRequestWorker::execute(HttpRequestInput input)
 void HttpRequestWorker::on_manager_finished(QNetworkReply *reply)
 {
     errorType = reply->error();
-    if (errorType == QNetworkReply::NoError)
+    if (errorType == QNetworkReply::NoError &&
+        reply->header(QNetworkRequest::ContentTypeHeader).toString() == "application/octet-stream")
+        rawResponse = reply->readAll();
+    else if (errorType == QNetworkReply::NoError)
     {
         response = reply->readAll();
         jsonResponse = QJsonDocument::fromJson(response.toUtf8());
@@ -4,6 +4,7 @@
 #ifndef HTTPREQUESTWORKER_H
 #define HTTPREQUESTWORKER_H
 
+#include <QByteArray>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -30,6 +31,8 @@ class HttpRequestWorker : public QObject
 
     public:
     QString response;
+    // Body of binary (application/octet-stream) responses, which are not decoded as text
+    QByteArray rawResponse;
     QNetworkReply::NetworkError errorType;
     QString errorString;
     QJsonDocument jsonResponse;
@@ -5,10 +5,11 @@
 #include <QDebug>
 #include <QJsonObject>
 #include <QTime>
+#include <algorithm>
 
 // Model to handle json data in table view
 JsonTableModel::JsonTableModel(const JsonTableModel::Header &header_, QObject *parent)
-    : QAbstractTableModel(parent), tableHeader_(header_)
+    : QAbstractTableModel(parent), tableHeader_(header_), grouped_(false)
 {
     tableGroupedHeader_.push_back(Heading({{"title", "Title"}, {"index", "title"}}));
     tableGroupedHeader_.push_back(Heading({{"title", "Total Duration"}, {"index", "duration"}}));
@@ -24,8 +25,47 @@ bool JsonTableModel::setJson(const QJsonArray &array)
     return true;
 }
 
+// Appends new runs to the end of the table, leaving selection, scroll and filter intact. Runs already held are
+// skipped, as overlapping refreshes can both deliver those after the same last run
+void JsonTableModel::appendJson(const QJsonArray &newRuns)
+{
+    auto lastRun = lastRunNumber();
+    QJsonArray array;
+    for (const auto &value : newRuns)
+        if (value.toObject().value("run_number").toString().toInt() > lastRun)
+            array.append(value);
+    if (array.isEmpty())
+        return;
+
+    // Grouped tables show new runs in their groups, and keep them in the held data for when ungrouped
+    if (grouped_)
+    {
+        for (const auto &value : array)
+        {
+            tableHoldJsonData_.append(value);
+            addToGroup(value.toObject());
+        }
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), tableJsonData_.size(), tableJsonData_.size() + array.size() - 1);
+    for (const auto &value : array)
+        tableJsonData_.append(value);
+    endInsertRows();
+}
+
 QJsonArray JsonTableModel::getJson() { return tableJsonData_; }
 
+// Returns the highest run number held, grouped or not
+int JsonTableModel::lastRunNumber() const
+{
+    const auto &data = grouped_ ? tableHoldJsonData_ : tableJsonData_;
+    auto lastRun = 0;
+    for (const auto &value : data)
+        lastRun = std::max(lastRun, value.toObject().value("run_number").toString().toInt());
+    return lastRun;
+}
+
 // Sets header_ data to define table
 bool JsonTableModel::setHeader(const Header &array)
 {
@@ -156,6 +196,32 @@ void JsonTableModel::groupData()
     // Get and assign array headers
     setHeader(tableGroupedHeader_);
     setJson(groupedJson);
+    grouped_ = true;
+}
+
+// Adds a run to the grouped row of its title, or to a new row at the end if the title is new
+void JsonTableModel::addToGroup(const QJsonObject &run)
+{
+    auto title = run["title"].toString();
+    for (auto row = 0; row < tableJsonData_.size(); ++row)
+    {
+        auto group = tableJsonData_[row].toObject();
+        if (group["title"].toString() != title)
+            continue;
+        auto currentTotal = QTime::fromString(group["duration"].toString(), "HH:mm:ss");
+        auto newTime = QTime(0, 0, 0).secsTo(QTime::fromString(run["duration"].toString(), "HH:mm:ss"));
+        group["duration"] = currentTotal.addSecs(newTime).toString("HH:mm:ss");
+        group["run_number"] = group["run_number"].toString() + ";" + run["run_number"].toString();
+        tableJsonData_[row] = group;
+        emit dataChanged(index(row, 0), index(row, columnCount() - 1), {Qt::DisplayRole});
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), tableJsonData_.size(), tableJsonData_.size());
+    tableJsonData_.append(QJsonObject({qMakePair(QString("title"), QJsonValue(title)),
+                                       qMakePair(QString("duration"), run["duration"]),
+                                       qMakePair(QString("run_number"), run["run_number"])}));
+    endInsertRows();
 }
 
 // Apply held (ungrouped) values to table
@@ -163,6 +229,7 @@ void JsonTableModel::unGroupData()
 {
     setHeader(tableHoldHeader_);
     setJson(tableHoldJsonData_);
+    grouped_ = false;
 }
 
 void JsonTableModel::setColumnTitle(int section, QString title) { tableHeader_[section]["index"] = title; }
@@ -21,7 +21,9 @@ class JsonTableModel : public QAbstractTableModel
     JsonTableModel(const Header &header_, QObject *parent = 0);
 
     bool setJson(const QJsonArray &array);
+    void appendJson(const QJsonArray &newRuns); // add rows without resetting the model
     QJsonArray getJson();
+    int lastRunNumber() const;
     bool setHeader(const Header &array);
     Header getHeader();
 
@@ -38,11 +40,14 @@ class JsonTableModel : public QAbstractTableModel
     bool insertRows(int row, int count, const QModelIndex &parent = QModelIndex());
 
     private:
+    void addToGroup(const QJsonObject &run);
+
     Header tableHeader_;
     Header tableHoldHeader_;
     Header tableGroupedHeader_;
     QJsonArray tableJsonData_;
     QJsonArray tableHoldJsonData_;
+    bool grouped_;
 };
 
 #endif // JSONTABLEMODEL_H
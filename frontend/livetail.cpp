@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "livetail.h"
+#include <algorithm>
+#include <limits>
+
+// Time between fetches of new samples (ms)
+const int LiveInterval = 10000;
+// Samples held per field, the oldest being dropped beyond it (~3 MB of times and values)
+const int LiveCapacity = 200000;
+
+RingBuffer::RingBuffer(int capacity) : x_(capacity), y_(capacity), start_(0), size_(0) {}
+
+int RingBuffer::size() const { return size_; }
+
+void RingBuffer::append(double x, double y)
+{
+    auto capacity = x_.size();
+    if (capacity == 0)
+        return;
+    auto index = (start_ + size_) % capacity;
+    x_[index] = x;
+    y_[index] = y;
+    if (size_ < capacity)
+        ++size_;
+    else
+        start_ = (start_ + 1) % capacity;
+}
+
+QSharedPointer<SeriesBuffer> RingBuffer::toSeries() const
+{
+    QVector<double> x;
+    QVector<double> y;
+    x.reserve(size_);
+    y.reserve(size_);
+    for (auto i = 0; i < size_; ++i)
+    {
+        auto index = (start_ + i) % x_.size();
+        x.append(x_[index]);
+        y.append(y_[index]);
+    }
+    return QSharedPointer<SeriesBuffer>::create(x, y);
+}
+
+qint64 RingBuffer::memoryUsage() const { return (x_.capacity() + y_.capacity()) * (qint64)sizeof(double); }
+
+LiveTail::LiveTail(QObject *parent) : QObject(parent), pending_(false)
+{
+    setObjectName("liveTail");
+    timer_ = new QTimer(this);
+    timer_->setInterval(LiveInterval);
+    connect(timer_, &QTimer::timeout, this, &LiveTail::pollDue);
+}
+
+void LiveTail::addSeries(const QVector<LogSeries> &series)
+{
+    for (const auto &logSeries : series)
+    {
+        // Runs in progress are the newest, so only the highest numbered is followed
+        if (!run_.isEmpty() && logSeries.run.toLongLong() < run_.toLongLong())
+            continue;
+        if (logSeries.run != run_)
+        {
+            run_ = logSeries.run;
+            last_.clear();
+            previousLast_.clear();
+            rings_.clear();
+        }
+        // String valued logs are drawn against categories, which tails would have to re-index, so are not followed
+        if (logSeries.data->interpolation() == SeriesBuffer::Step)
+            continue;
+        auto last = logSeries.tileLevels > 0 ? logSeries.tileLast
+                    : logSeries.data->size() > 0 ? logSeries.data->x(logSeries.data->size() - 1)
+                                                 : std::numeric_limits<double>::lowest();
+        last_[logSeries.field] = std::max(last, last_.value(logSeries.field, last));
+        previousLast_[logSeries.field] = last_[logSeries.field];
+    }
+}
+
+QString LiveTail::run() const { return last_.isEmpty() ? QString() : run_; }
+
+double LiveTail::since() const
+{
+    auto since = std::numeric_limits<double>::max();
+    for (auto last : last_)
+        since = std::min(since, last);
+    return std::max(since, 0.0);
+}
+
+void LiveTail::setActive(bool active)
+{
+    if (active)
+    {
+        timer_->start();
+        emit pollDue();
+    }
+    else
+        timer_->stop();
+}
+
+bool LiveTail::isActive() const { return timer_->isActive(); }
+
+void LiveTail::setPending(bool pending) { pending_ = pending; }
+
+bool LiveTail::isPending() const { return pending_; }
+
+QStringList LiveTail::append(const QVector<LogSeries> &series)
+{
+    QStringList grown;
+    for (const auto &logSeries : series)
+    {
+        if (logSeries.run != run_ || !last_.contains(logSeries.field))
+            continue;
+        // Fields are fetched from the earliest of their last times, so skip samples already held
+        const auto &data = *logSeries.data;
+        auto last = last_[logSeries.field];
+        auto index = data.lowerBound(last);
+        while (index < data.size() && data.x(index) <= last)
+            ++index;
+        if (index == data.size())
+            continue;
+
+        auto &ring = rings_[logSeries.field];
+        if (ring.size() == 0)
+            ring = RingBuffer(LiveCapacity);
+        for (; index < data.size(); ++index)
+            ring.append(data.x(index), data.y(index));
+        previousLast_[logSeries.field] = last;
+        last_[logSeries.field] = data.x(data.size() - 1);
+        grown.append(logSeries.field);
+    }
+    return grown;
+}
+
+double LiveTail::previousLast(const QString &field) const { return previousLast_.value(field); }
+
+QSharedPointer<SeriesBuffer> LiveTail::data(const QString &field) const
+{
+    return rings_.contains(field) ? rings_[field].toSeries() : QSharedPointer<SeriesBuffer>::create();
+}
+
+qint64 LiveTail::memoryUsage() const
+{
+    qint64 bytes = 0;
+    for (const auto &ring : rings_)
+        bytes += ring.memoryUsage();
+    return bytes;
+}
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef LIVETAIL_H
+#define LIVETAIL_H
+
+#include "logdata.h"
+#include <QHash>
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+// The newest samples of a growing series in fixed memory, overwriting the oldest once full
+class RingBuffer
+{
+    public:
+    RingBuffer(int capacity = 0);
+
+    int size() const;
+    void append(double x, double y);
+    // Samples held, oldest first, for drawing
+    QSharedPointer<SeriesBuffer> toSeries() const;
+    qint64 memoryUsage() const;
+
+    private:
+    QVector<double> x_;
+    QVector<double> y_;
+    // Index of the oldest sample
+    int start_;
+    int size_;
+};
+
+// Live tail of a log window: samples of its latest run recorded since those plotted, polled for while active and held
+// per field in ring buffers, so following a run in progress neither refetches nor grows without bound
+class LiveTail : public QObject
+{
+    Q_OBJECT
+
+    public:
+    LiveTail(QObject *parent = nullptr);
+
+    // Follow the latest run of plotted series, from the last time each of its fields was recorded
+    void addSeries(const QVector<LogSeries> &series);
+    QString run() const;
+    // Time (seconds from run start) after which to fetch, covering every field
+    double since() const;
+    // Poll periodically while active
+    void setActive(bool active);
+    bool isActive() const;
+    // Whether a fetch is in flight, which later polls wait for
+    void setPending(bool pending);
+    bool isPending() const;
+    // Take fetched samples newer than those held, returning the fields which grew
+    QStringList append(const QVector<LogSeries> &series);
+    // Last time of a field before it last grew, and the samples received for it since going live
+    double previousLast(const QString &field) const;
+    QSharedPointer<SeriesBuffer> data(const QString &field) const;
+    // Heap held by the ring buffers
+    qint64 memoryUsage() const;
+
+    signals:
+    void pollDue();
+
+    private:
+    QTimer *timer_;
+    bool pending_;
+    QString run_;
+    QHash<QString, double> last_;
+    QHash<QString, double> previousLast_;
+    QHash<QString, RingBuffer> rings_;
+};
+
+#endif // LIVETAIL_H
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "logdata.h"
+#include <QHash>
+
+LogData LogData::fromJson(const QJsonArray &runs)
+{
+    LogData data;
+
+    // String values are encoded once through a dictionary as they are read, in first seen order
+    QHash<QString, int> dictionary;
+    struct CategoricalSeries
+    {
+        int index;
+        QVector<double> times;
+        QVector<int> codes;
+    };
+    QVector<CategoricalSeries> categoricalSeries;
+
+    // For each run
+    for (const auto &runFields : runs)
+    {
+        auto runFieldsArray = runFields.toArray();
+        if (runFieldsArray.count() < 2 || !runFieldsArray.first().isArray())
+            continue;
+        auto startTime = QDateTime::fromString(runFieldsArray.first()[0].toString(), "yyyy-MM-dd'T'HH:mm:ss");
+        auto endTime = QDateTime::fromString(runFieldsArray.first()[1].toString(), "yyyy-MM-dd'T'HH:mm:ss");
+
+        // For each field
+        for (auto i = 1; i < runFieldsArray.count(); ++i)
+        {
+            auto fieldDataArray = runFieldsArray[i].toArray();
+            if (fieldDataArray.count() < 2)
+                continue;
+
+            LogSeries series;
+            series.run = fieldDataArray.first()[0].toString();
+            series.field = fieldDataArray.first()[1].toString().section(':', -1);
+            series.startTime = startTime;
+            series.endTime = endTime;
+            // Tiles carry the log's span and levels, and rows of [time, min, max, mean, count] below the finest level
+            auto aggregated = false;
+            if (fieldDataArray.first().toArray().count() >= 8)
+            {
+                series.tileFirst = fieldDataArray.first()[2].toDouble();
+                series.tileLast = fieldDataArray.first()[3].toDouble();
+                series.tileLevels = fieldDataArray.first()[4].toInt();
+                series.tileBuckets = fieldDataArray.first()[7].toInt();
+                aggregated = fieldDataArray.first()[5].toInt() < series.tileLevels;
+            }
+            if (fieldDataArray[1].toArray()[1].isString())
+            {
+                // Run length compress, keeping only the sample at which each state begins (and the last, so the
+                // series spans its full time range)
+                CategoricalSeries categorical;
+                categorical.index = data.series.count();
+                for (auto j = 1; j < fieldDataArray.count(); ++j)
+                {
+                    auto dataPairArray = fieldDataArray[j].toArray();
+                    auto value = dataPairArray[1].toString();
+                    auto code = dictionary.value(value, -1);
+                    if (code == -1)
+                    {
+                        code = dictionary.count();
+                        dictionary.insert(value, code);
+                        data.categories.append(value);
+                    }
+                    if (!categorical.codes.isEmpty() && categorical.codes.last() == code && j < fieldDataArray.count() - 1)
+                        continue;
+                    categorical.times.append(dataPairArray[0].toDouble());
+                    categorical.codes.append(code);
+                }
+                categoricalSeries.append(categorical);
+            }
+            else
+            {
+                QVector<double> times;
+                QVector<double> values;
+                times.reserve(fieldDataArray.count() - 1);
+                values.reserve(fieldDataArray.count() - 1);
+                for (auto j = 1; j < fieldDataArray.count(); ++j)
+                {
+                    auto dataPairArray = fieldDataArray[j].toArray();
+                    times.append(dataPairArray[0].toDouble());
+                    values.append(dataPairArray[1].toDouble());
+                    // Draw each bucket from its min to its max
+                    if (aggregated)
+                    {
+                        times.append(dataPairArray[0].toDouble());
+                        values.append(dataPairArray[2].toDouble());
+                    }
+                }
+                series.data = QSharedPointer<SeriesBuffer>::create(times, values);
+            }
+            data.series.append(series);
+        }
+    }
+
+    // Remap codes to sorted label order so category indices agree between series, and draw states as steps
+    if (!categoricalSeries.isEmpty())
+    {
+        auto sorted = data.categories;
+        sorted.sort();
+        QVector<double> sortedIndex(sorted.count());
+        for (auto i = 0; i < sorted.count(); ++i)
+            sortedIndex[dictionary[sorted[i]]] = i;
+        for (const auto &categorical : categoricalSeries)
+        {
+            QVector<double> values;
+            values.reserve(categorical.codes.count());
+            for (auto code : categorical.codes)
+                values.append(sortedIndex[code]);
+            data.series[categorical.index].data =
+                QSharedPointer<SeriesBuffer>::create(categorical.times, values, SeriesBuffer::Step);
+        }
+        data.categories = sorted;
+    }
+    return data;
+}
+
+void LogData::mergeCategories(QStringList &labels)
+{
+    QVector<double> labelIndex(categories.count());
+    auto unchanged = true;
+    for (auto i = 0; i < categories.count(); ++i)
+    {
+        auto index = labels.indexOf(categories[i]);
+        if (index == -1)
+        {
+            index = labels.count();
+            labels.append(categories[i]);
+        }
+        labelIndex[i] = index;
+        unchanged = unchanged && index == i;
+    }
+    categories = labels;
+    if (unchanged)
+        return;
+
+    for (auto &log : series)
+    {
+        if (log.data->interpolation() != SeriesBuffer::Step)
+            continue;
+        QVector<double> times;
+        QVector<double> values;
+        times.reserve(log.data->size());
+        values.reserve(log.data->size());
+        for (auto i = 0; i < log.data->size(); ++i)
+        {
+            times.append(log.data->x(i));
+            values.append(labelIndex[(int)log.data->y(i)]);
+        }
+        log.data = QSharedPointer<SeriesBuffer>::create(times, values, SeriesBuffer::Step);
+    }
+}
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef LOGDATA_H
+#define LOGDATA_H
+
+#include "seriesbuffer.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Values of one log field over one run
+class LogSeries
+{
+    public:
+    QString run;
+    QString field;
+    QDateTime startTime;
+    QDateTime endTime;
+    // Seconds relative to run start against value, shared by every view of the series. String valued logs
+    // hold a category index at each change of state and are drawn as steps
+    QSharedPointer<SeriesBuffer> data;
+    // Long logs arrive as level of detail tiles (see LogTiles), of which data then holds the whole span at its
+    // coarsest as per-bucket min/max pairs. Zero levels when data holds every sample
+    int tileLevels = 0;
+    int tileBuckets = 0;
+    double tileFirst = 0.0;
+    double tileLast = 0.0;
+};
+
+// Log series parsed from a /getNexusData response
+class LogData
+{
+    public:
+    QVector<LogSeries> series;
+    QStringList categories;
+
+    // Parse the per-run blocks of a response (safe to call off the GUI thread)
+    static LogData fromJson(const QJsonArray &runs);
+    // Re-index categories against labels already plotted, appending any new ones to them
+    void mergeCategories(QStringList &labels);
+};
+
+#endif // LOGDATA_H
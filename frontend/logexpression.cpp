@@ -0,0 +1,365 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "logexpression.h"
+#include "logjoin.h"
+#include <algorithm>
+#include <cmath>
+
+bool LogExpression::parse(const QString &text, QString &error)
+{
+    text_ = text.trimmed();
+    fields_.clear();
+    program_.clear();
+    position_ = 0;
+    error_.clear();
+
+    auto result = parseSum();
+    skipSpace();
+    if (result != -1 && position_ < text_.size())
+        fail("unexpected '" + text_.mid(position_, 1) + "'");
+    else if (result != -1 && fields_.isEmpty())
+        fail("no fields are read");
+    if (!error_.isEmpty())
+    {
+        error = error_;
+        program_.clear();
+        return false;
+    }
+    return true;
+}
+
+QString LogExpression::text() const { return text_; }
+QStringList LogExpression::fields() const { return fields_; }
+
+void LogExpression::skipSpace()
+{
+    while (position_ < text_.size() && text_[position_].isSpace())
+        ++position_;
+}
+
+int LogExpression::fail(const QString &message)
+{
+    // Keep the first, innermost, problem
+    if (error_.isEmpty())
+        error_ = message + " at character " + QString::number(position_ + 1) + " of '" + text_ + "'";
+    return -1;
+}
+
+int LogExpression::append(Operation::Code code, int a, int b, double value)
+{
+    program_.append({code, value, -1, a, b});
+    return program_.size() - 1;
+}
+
+int LogExpression::parseSum()
+{
+    auto left = parseProduct();
+    while (left != -1)
+    {
+        skipSpace();
+        if (position_ >= text_.size() || (text_[position_] != '+' && text_[position_] != '-'))
+            break;
+        auto code = text_[position_] == '+' ? Operation::Add : Operation::Subtract;
+        ++position_;
+        auto right = parseProduct();
+        if (right == -1)
+            return -1;
+        left = append(code, left, right);
+    }
+    return left;
+}
+
+int LogExpression::parseProduct()
+{
+    auto left = parseUnary();
+    while (left != -1)
+    {
+        skipSpace();
+        if (position_ >= text_.size() || (text_[position_] != '*' && text_[position_] != '/'))
+            break;
+        auto code = text_[position_] == '*' ? Operation::Multiply : Operation::Divide;
+        ++position_;
+        auto right = parseUnary();
+        if (right == -1)
+            return -1;
+        left = append(code, left, right);
+    }
+    return left;
+}
+
+int LogExpression::parseUnary()
+{
+    skipSpace();
+    if (position_ < text_.size() && text_[position_] == '-')
+    {
+        ++position_;
+        auto operand = parseUnary();
+        return operand == -1 ? -1 : append(Operation::Negate, operand);
+    }
+    if (position_ < text_.size() && text_[position_] == '+')
+        ++position_;
+    return parsePrimary();
+}
+
+int LogExpression::parsePrimary()
+{
+    skipSpace();
+    if (position_ >= text_.size())
+        return fail("expression ends early");
+    auto c = text_[position_];
+
+    if (c == '(')
+    {
+        ++position_;
+        auto inner = parseSum();
+        if (inner == -1)
+            return -1;
+        skipSpace();
+        if (position_ >= text_.size() || text_[position_] != ')')
+            return fail("missing ')'");
+        ++position_;
+        return inner;
+    }
+
+    // Numbers, optionally with an exponent and a duration unit
+    if (c.isDigit() || c == '.')
+    {
+        auto start = position_;
+        while (position_ < text_.size() && (text_[position_].isDigit() || text_[position_] == '.'))
+            ++position_;
+        if (position_ + 1 < text_.size() && text_[position_].toLower() == 'e' &&
+            (text_[position_ + 1].isDigit() ||
+             ((text_[position_ + 1] == '-' || text_[position_ + 1] == '+') && position_ + 2 < text_.size() &&
+              text_[position_ + 2].isDigit())))
+        {
+            position_ += 2;
+            while (position_ < text_.size() && text_[position_].isDigit())
+                ++position_;
+        }
+        auto ok = false;
+        auto value = text_.mid(start, position_ - start).toDouble(&ok);
+        if (!ok)
+        {
+            position_ = start;
+            return fail("invalid number");
+        }
+        auto unitStart = position_;
+        while (position_ < text_.size() && text_[position_].isLetter())
+            ++position_;
+        auto unit = text_.mid(unitStart, position_ - unitStart);
+        if (unit == "min")
+            value *= 60.0;
+        else if (unit == "h")
+            value *= 3600.0;
+        else if (!unit.isEmpty() && unit != "s")
+        {
+            position_ = unitStart;
+            return fail("unknown unit '" + unit + "'");
+        }
+        return append(Operation::Constant, -1, -1, value);
+    }
+
+    // Quoted names are always fields; plain words followed by '(' are functions
+    QString name;
+    if (c == '"')
+    {
+        auto end = text_.indexOf('"', position_ + 1);
+        if (end == -1)
+            return fail("missing closing '\"'");
+        name = text_.mid(position_ + 1, end - position_ - 1);
+        position_ = end + 1;
+    }
+    else if (c.isLetter() || c == '_')
+    {
+        auto start = position_;
+        while (position_ < text_.size() &&
+               (text_[position_].isLetterOrNumber() || text_[position_] == '_' || text_[position_] == '.'))
+            ++position_;
+        name = text_.mid(start, position_ - start);
+        skipSpace();
+        if (position_ < text_.size() && text_[position_] == '(')
+            return parseCall(name);
+    }
+    else
+        return fail("unexpected '" + QString(c) + "'");
+
+    auto index = fields_.indexOf(name);
+    if (index == -1)
+    {
+        index = fields_.size();
+        fields_.append(name);
+    }
+    auto operation = append(Operation::Field);
+    program_[operation].field = index;
+    return operation;
+}
+
+int LogExpression::parseCall(const QString &name)
+{
+    auto start = position_;
+    // Skip the '('
+    ++position_;
+    QVector<int> arguments;
+    skipSpace();
+    if (position_ < text_.size() && text_[position_] != ')')
+        while (true)
+        {
+            auto argument = parseSum();
+            if (argument == -1)
+                return -1;
+            arguments.append(argument);
+            skipSpace();
+            if (position_ >= text_.size() || text_[position_] != ',')
+                break;
+            ++position_;
+        }
+    if (position_ >= text_.size() || text_[position_] != ')')
+        return fail("missing ')'");
+    ++position_;
+
+    if (name == "moving_avg")
+    {
+        if (arguments.size() != 2 || program_[arguments[1]].code != Operation::Constant ||
+            program_[arguments[1]].value <= 0.0)
+        {
+            position_ = start;
+            return fail("moving_avg takes a value and a window, e.g. moving_avg(pressure, 60s)");
+        }
+        return append(Operation::MovingAverage, arguments[0], -1, program_[arguments[1]].value);
+    }
+
+    const QHash<QString, Operation::Code> functions = {{"abs", Operation::Absolute},
+                                                       {"sqrt", Operation::SquareRoot},
+                                                       {"exp", Operation::Exponential},
+                                                       {"log", Operation::Logarithm},
+                                                       {"derivative", Operation::Derivative}};
+    if (!functions.contains(name) || arguments.size() != 1)
+    {
+        position_ = start;
+        return fail(functions.contains(name) ? name + " takes one value" : "unknown function '" + name + "'");
+    }
+    return append(functions[name], arguments[0]);
+}
+
+QSharedPointer<SeriesBuffer> LogExpression::evaluate(const QHash<QString, QSharedPointer<SeriesBuffer>> &fields) const
+{
+    QVector<const SeriesBuffer *> channels;
+    for (const auto &name : fields_)
+    {
+        auto data = fields.value(name);
+        if (!data || program_.isEmpty())
+            return QSharedPointer<SeriesBuffer>::create();
+        channels.append(data.data());
+    }
+    QVector<double> times;
+    auto columns = LogJoin().join(channels, QVector<double>(channels.size(), 0.0), &times);
+    auto size = (int)times.size();
+    const auto *t = times.constData();
+
+    // Each operation is a branch free loop over contiguous columns, so the compiler can vectorise it
+    QVector<QVector<double>> results(program_.size());
+    for (auto i = 0; i < program_.size(); ++i)
+    {
+        const auto &operation = program_[i];
+        auto &result = results[i];
+        if (operation.code == Operation::Field)
+        {
+            result = columns[operation.field];
+            continue;
+        }
+        result.resize(size);
+        auto *r = result.data();
+        const auto *a = operation.a >= 0 ? results[operation.a].constData() : nullptr;
+        const auto *b = operation.b >= 0 ? results[operation.b].constData() : nullptr;
+        switch (operation.code)
+        {
+            case Operation::Constant:
+                std::fill(r, r + size, operation.value);
+                break;
+            case Operation::Add:
+                for (auto j = 0; j < size; ++j)
+                    r[j] = a[j] + b[j];
+                break;
+            case Operation::Subtract:
+                for (auto j = 0; j < size; ++j)
+                    r[j] = a[j] - b[j];
+                break;
+            case Operation::Multiply:
+                for (auto j = 0; j < size; ++j)
+                    r[j] = a[j] * b[j];
+                break;
+            case Operation::Divide:
+                for (auto j = 0; j < size; ++j)
+                    r[j] = a[j] / b[j];
+                break;
+            case Operation::Negate:
+                for (auto j = 0; j < size; ++j)
+                    r[j] = -a[j];
+                break;
+            case Operation::Absolute:
+                for (auto j = 0; j < size; ++j)
+                    r[j] = std::fabs(a[j]);
+                break;
+            case Operation::SquareRoot:
+                for (auto j = 0; j < size; ++j)
+                    r[j] = std::sqrt(a[j]);
+                break;
+            case Operation::Exponential:
+                for (auto j = 0; j < size; ++j)
+                    r[j] = std::exp(a[j]);
+                break;
+            case Operation::Logarithm:
+                for (auto j = 0; j < size; ++j)
+                    r[j] = std::log(a[j]);
+                break;
+            case Operation::Derivative:
+                // Central differences, one sided at the ends. Joined times are strictly increasing
+                if (size < 2)
+                {
+                    std::fill(r, r + size, 0.0);
+                    break;
+                }
+                for (auto j = 1; j < size - 1; ++j)
+                    r[j] = (a[j + 1] - a[j - 1]) / (t[j + 1] - t[j - 1]);
+                r[0] = (a[1] - a[0]) / (t[1] - t[0]);
+                r[size - 1] = (a[size - 1] - a[size - 2]) / (t[size - 1] - t[size - 2]);
+                break;
+            case Operation::MovingAverage:
+            {
+                // Mean of the samples within half a window either side, from prefix sums
+                QVector<double> sums(size + 1, 0.0);
+                for (auto j = 0; j < size; ++j)
+                    sums[j + 1] = sums[j] + a[j];
+                auto halfWidth = operation.value / 2;
+                auto low = 0;
+                auto high = 0;
+                for (auto j = 0; j < size; ++j)
+                {
+                    while (t[low] < t[j] - halfWidth)
+                        ++low;
+                    while (high < size && t[high] <= t[j] + halfWidth)
+                        ++high;
+                    r[j] = (sums[high] - sums[low]) / (high - low);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // Drop undefined values (e.g. division by zero, or logarithms of negative values), which cannot be drawn
+    const auto &values = results.last();
+    QVector<double> x;
+    QVector<double> y;
+    x.reserve(size);
+    y.reserve(size);
+    for (auto j = 0; j < size; ++j)
+        if (std::isfinite(values[j]))
+        {
+            x.append(t[j]);
+            y.append(values[j]);
+        }
+    return QSharedPointer<SeriesBuffer>::create(x, y);
+}
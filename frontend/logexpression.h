@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef LOGEXPRESSION_H
+#define LOGEXPRESSION_H
+
+#include "seriesbuffer.h"
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// A channel computed from log fields, e.g. "T_sample - T_setpoint", "moving_avg(pressure, 60s)" or
+// "derivative(field)". Fields are named as on the plot, or quoted ("Field name") if not plain words; durations take
+// an s, min or h suffix. The expression is parsed once into a program of whole-array operations, each a loop over
+// contiguous values, which is run over the fields of a run aligned on their common times
+class LogExpression
+{
+    public:
+    // Parse text, returning false with a description of the problem if it is not a valid expression
+    bool parse(const QString &text, QString &error);
+    QString text() const;
+    // Fields read by the expression
+    QStringList fields() const;
+    // Values over the times any field was recorded, within the span all cover, from one run's fields by name
+    QSharedPointer<SeriesBuffer> evaluate(const QHash<QString, QSharedPointer<SeriesBuffer>> &fields) const;
+
+    private:
+    // One operation, producing a column from constants, fields or the columns of earlier operations
+    struct Operation
+    {
+        enum Code
+        {
+            Constant,
+            Field,
+            Add,
+            Subtract,
+            Multiply,
+            Divide,
+            Negate,
+            Absolute,
+            SquareRoot,
+            Exponential,
+            Logarithm,
+            Derivative,
+            MovingAverage
+        };
+        Code code;
+        // Constant value, or moving average window in seconds
+        double value;
+        // Index into fields_ for Field, or of the operand operations
+        int field;
+        int a;
+        int b;
+    };
+    QString text_;
+    QStringList fields_;
+    // Operations in evaluation order, the last giving the result
+    QVector<Operation> program_;
+
+    // Recursive descent over text_ from position_, appending operations and returning the index of the last
+    int position_;
+    QString error_;
+    int parseSum();
+    int parseProduct();
+    int parseUnary();
+    int parsePrimary();
+    int parseCall(const QString &name);
+    int append(Operation::Code code, int a = -1, int b = -1, double value = 0.0);
+    void skipSpace();
+    // Record the first problem found, returning -1 for the parse functions to pass up
+    int fail(const QString &message);
+};
+
+#endif // LOGEXPRESSION_H
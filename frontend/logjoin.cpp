@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "logjoin.h"
+#include <algorithm>
+#include <limits>
+
+LogJoin::LogJoin(Method method) : method_(method) {}
+
+double LogJoin::valueAt(const SeriesBuffer &channel, int &cursor, double t) const
+{
+    while (cursor < channel.size() - 1 && channel.x(cursor + 1) <= t)
+        ++cursor;
+    if (method_ == HoldLast || channel.interpolation() == SeriesBuffer::Step || cursor == channel.size() - 1 ||
+        channel.x(cursor) >= t)
+        return channel.y(cursor);
+    auto fraction = (t - channel.x(cursor)) / (channel.x(cursor + 1) - channel.x(cursor));
+    return channel.y(cursor) + fraction * (channel.y(cursor + 1) - channel.y(cursor));
+}
+
+QVector<QVector<double>> LogJoin::join(const QVector<const SeriesBuffer *> &channels, const QVector<double> &lags,
+                                       QVector<double> *times) const
+{
+    if (times)
+        times->clear();
+    auto count = channels.size();
+    QVector<QVector<double>> columns(count);
+    if (count == 0)
+        return columns;
+
+    // Span covered by every channel, in joined time
+    auto first = std::numeric_limits<double>::lowest();
+    auto last = std::numeric_limits<double>::max();
+    for (auto c = 0; c < count; ++c)
+    {
+        const auto &channel = *channels[c];
+        if (channel.size() == 0)
+            return columns;
+        first = std::max(first, channel.x(0) + lags.value(c));
+        last = std::min(last, channel.x(channel.size() - 1) + lags.value(c));
+    }
+    if (last < first)
+        return columns;
+
+    // Merge walk over the sorted sample times of all channels: each step takes the earliest next time, reads every
+    // channel there, and advances each channel recorded at it
+    QVector<int> next(count);
+    QVector<int> cursors(count, 0);
+    auto size = 0;
+    for (auto c = 0; c < count; ++c)
+    {
+        next[c] = channels[c]->lowerBound(first - lags.value(c));
+        size += channels[c]->size() - next[c];
+    }
+    for (auto &column : columns)
+        column.reserve(size);
+    if (times)
+        times->reserve(size);
+    while (true)
+    {
+        auto t = std::numeric_limits<double>::max();
+        for (auto c = 0; c < count; ++c)
+            if (next[c] < channels[c]->size())
+                t = std::min(t, channels[c]->x(next[c]) + lags.value(c));
+        if (t > last)
+            break;
+        for (auto c = 0; c < count; ++c)
+            if (next[c] < channels[c]->size() && channels[c]->x(next[c]) + lags.value(c) == t)
+                ++next[c];
+        // Rounding of shifted times can step just outside the common span
+        if (t < first)
+            continue;
+        for (auto c = 0; c < count; ++c)
+            columns[c].append(valueAt(*channels[c], cursors[c], t - lags.value(c)));
+        if (times)
+            times->append(t);
+    }
+    return columns;
+}
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef LOGJOIN_H
+#define LOGJOIN_H
+
+#include "seriesbuffer.h"
+#include <QVector>
+
+// Log series joined by time: every channel's value at each time any of them was recorded, over the span all cover
+class LogJoin
+{
+    public:
+    // How a channel's value is found between its samples. String valued (step) logs always hold
+    enum Method
+    {
+        Interpolate,
+        HoldLast
+    };
+    LogJoin(Method method = Interpolate);
+
+    // Join channels whose times are shifted by the given lags (in seconds, so channel c is read at t - lags[c]),
+    // returning one column of values per channel, and optionally the joined times
+    QVector<QVector<double>> join(const QVector<const SeriesBuffer *> &channels, const QVector<double> &lags,
+                                  QVector<double> *times = nullptr) const;
+
+    private:
+    Method method_;
+
+    // Value at time t, advancing cursor to the last sample at or before it
+    double valueAt(const SeriesBuffer &channel, int &cursor, double t) const;
+};
+
+#endif // LOGJOIN_H
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "logtiles.h"
+#include <algorithm>
+#include <cmath>
+
+LogTiles::LogTiles(QObject *parent) : QObject(parent) { setObjectName("logTiles"); }
+
+void LogTiles::setCycles(const QStringList &runs, const QStringList &cycles)
+{
+    for (auto i = 0; i < runs.size(); ++i)
+        cycles_[runs[i]] = cycles.value(i, " ");
+}
+
+QString LogTiles::cycle(const QString &run) const { return cycles_.value(run, " "); }
+
+void LogTiles::addSeries(const QVector<LogSeries> &series)
+{
+    for (const auto &logSeries : series)
+    {
+        if (logSeries.tileLevels == 0 || runs_.contains({logSeries.run, logSeries.field}))
+            continue;
+        TiledRun tiled;
+        tiled.first = logSeries.tileFirst;
+        tiled.last = logSeries.tileLast;
+        tiled.levels = logSeries.tileLevels;
+        tiled.buckets = std::max(logSeries.tileBuckets, 1);
+        tiled.base = logSeries.data;
+        tiled.level = 0;
+        runs_[{logSeries.run, logSeries.field}] = tiled;
+    }
+}
+
+bool LogTiles::isTiled(const QString &run, const QString &field) const { return runs_.contains({run, field}); }
+
+QVector<LogTiles::Tile> LogTiles::wanted(const QString &run, const QString &field, double first, double last,
+                                         int pixels)
+{
+    QVector<Tile> tiles;
+    auto it = runs_.find({run, field});
+    auto span = it == runs_.end() ? 0.0 : it->last - it->first;
+    if (it == runs_.end() || span <= 0.0 || last <= first || pixels <= 0)
+        return tiles;
+
+    // Coarsest level whose buckets are no wider than a pixel
+    auto level = (int)std::ceil(std::log2(span * pixels / ((last - first) * it->buckets)));
+    level = std::clamp(level, 0, it->levels);
+    // Tiles of the previous level stay drawn until those of the new one arrive
+    if (level != it->level)
+    {
+        it->level = level;
+        it->tiles.clear();
+        it->requested.clear();
+    }
+    if (level == 0)
+        return tiles;
+
+    auto count = 1 << level;
+    auto width = span / count;
+    auto from = std::clamp((int)std::floor((first - it->first) / width), 0, count - 1);
+    auto to = std::clamp((int)std::floor((last - it->first) / width), 0, count - 1);
+    for (auto index = from; index <= to; ++index)
+        if (!it->tiles.contains(index) && !it->requested.contains(index))
+        {
+            it->requested.insert(index);
+            tiles.append({run, field, level, index});
+        }
+    return tiles;
+}
+
+QString LogTiles::item(const Tile &tile) { return QString::number(tile.level) + "/" + QString::number(tile.index); }
+
+QSharedPointer<SeriesBuffer> LogTiles::addTile(const Tile &tile, const QSharedPointer<SeriesBuffer> &data)
+{
+    auto it = runs_.find({tile.run, tile.field});
+    if (it == runs_.end() || tile.level != it->level || !it->requested.remove(tile.index))
+        return {};
+    it->tiles[tile.index] = data;
+
+    // The tiles held, with the level 0 buckets outside them
+    auto width = (it->last - it->first) / (1 << it->level);
+    QVector<QPair<double, double>> points;
+    for (auto i = 0; i < it->base->size(); ++i)
+    {
+        auto index = std::min((int)std::floor((it->base->x(i) - it->first) / width), (1 << it->level) - 1);
+        if (!it->tiles.contains(index))
+            points.append({it->base->x(i), it->base->y(i)});
+    }
+    for (const auto &tileData : it->tiles)
+        for (auto i = 0; i < tileData->size(); ++i)
+            points.append({tileData->x(i), tileData->y(i)});
+    // Stable, as each aggregated bucket is a min and max at one time
+    std::stable_sort(points.begin(), points.end(),
+                     [](const QPair<double, double> &a, const QPair<double, double> &b) { return a.first < b.first; });
+
+    QVector<double> x(points.size());
+    QVector<double> y(points.size());
+    for (auto i = 0; i < points.size(); ++i)
+    {
+        x[i] = points[i].first;
+        y[i] = points[i].second;
+    }
+    return QSharedPointer<SeriesBuffer>::create(x, y);
+}
+
+void LogTiles::dropRequest(const Tile &tile)
+{
+    auto it = runs_.find({tile.run, tile.field});
+    if (it != runs_.end() && tile.level == it->level)
+        it->requested.remove(tile.index);
+}
+
+bool LogTiles::requestSamples(const QString &run, const QString &field)
+{
+    if (samplesRequested_.contains({run, field}))
+        return false;
+    samplesRequested_.insert({run, field});
+    return true;
+}
+
+void LogTiles::dropSamplesRequest(const QString &run, const QString &field) { samplesRequested_.remove({run, field}); }
+
+bool LogTiles::holdsSeries() const { return !runs_.isEmpty(); }
+
+qint64 LogTiles::memoryUsage(QSet<const void *> &counted) const
+{
+    qint64 bytes = 0;
+    auto add = [&](const QSharedPointer<SeriesBuffer> &data) {
+        if (data && !counted.contains(data.data()))
+        {
+            counted.insert(data.data());
+            bytes += data->memoryUsage();
+        }
+    };
+    for (const auto &tiled : runs_)
+    {
+        add(tiled.base);
+        for (const auto &tile : tiled.tiles)
+            add(tile);
+    }
+    return bytes;
+}
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef LOGTILES_H
+#define LOGTILES_H
+
+#include "logdata.h"
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QVector>
+
+// Level of detail tiles of the long logs in a log window. The backend splits a log's span into 2^level tiles at each
+// level, each of a fixed number of min/max buckets, down to raw samples at the finest. Runs start from their single
+// level 0 tile, and finer tiles are fetched only for the range in view, so the data sent is bounded by the view
+// rather than the log's length
+class LogTiles : public QObject
+{
+    Q_OBJECT
+
+    public:
+    LogTiles(QObject *parent = nullptr);
+
+    struct Tile
+    {
+        QString run;
+        QString field;
+        int level;
+        int index;
+    };
+
+    // Cycle each run is read from
+    void setCycles(const QStringList &runs, const QStringList &cycles);
+    QString cycle(const QString &run) const;
+    // Take the level 0 tiles of any tiled series
+    void addSeries(const QVector<LogSeries> &series);
+    bool isTiled(const QString &run, const QString &field) const;
+    // Tiles of a run's field needed to show [first, last] (seconds from run start) over a number of pixels, that are
+    // neither held nor already requested. They are then marked as requested
+    QVector<Tile> wanted(const QString &run, const QString &field, double first, double last, int pixels);
+    // Request item for a tile, after the field
+    static QString item(const Tile &tile);
+    // Add an arrived tile, returning the field's data rebuilt from the finest tiles held, or null if the tile is stale
+    QSharedPointer<SeriesBuffer> addTile(const Tile &tile, const QSharedPointer<SeriesBuffer> &data);
+    // Forget a failed request so it is tried again
+    void dropRequest(const Tile &tile);
+    // Mark the whole log of a tiled field as asked for, by features needing every sample, returning false if it
+    // already was
+    bool requestSamples(const QString &run, const QString &field);
+    void dropSamplesRequest(const QString &run, const QString &field);
+    // Whether tiled series are held, and the heap their tiles take that is not already counted
+    bool holdsSeries() const;
+    qint64 memoryUsage(QSet<const void *> &counted) const;
+
+    private:
+    struct TiledRun
+    {
+        double first;
+        double last;
+        int levels;
+        int buckets;
+        QSharedPointer<SeriesBuffer> base;
+        // Tiles held and requested at the current level; moving to another level drops them
+        int level;
+        QMap<int, QSharedPointer<SeriesBuffer>> tiles;
+        QSet<int> requested;
+    };
+    QHash<QString, QString> cycles_;
+    // Tiled logs by run and field
+    QHash<QPair<QString, QString>, TiledRun> runs_;
+    QSet<QPair<QString, QString>> samplesRequested_;
+};
+
+#endif // LOGTILES_H
@@ -12,6 +12,7 @@
 #include <QDebug>
 #include <QDialog>
 #include <QDialogButtonBox>
+#include <QDir>
 #include <QDomDocument>
 #include <QFormLayout>
 #include <QInputDialog>
@@ -26,18 +27,38 @@
 #include <QTimer>
 #include <QWidgetAction>
 #include <QtGui>
+#include <algorithm>
 
 #include "./ui_graphwidget.h"
 #include "graphwidget.h"
 
+// Archive polling intervals (ms), backed off while nothing changes
+const int MinPollInterval = 30000;
+const int MaxPollInterval = 300000;
+// Memory (MB) plot tabs may hold before the least recently shown are hibernated
+const int DefaultPlotMemoryBudget = 1024;
+// Interval (ms) between checks of plot tab memory, as data arrives after tabs open
+const int MemoryCheckInterval = 5000;
+
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui_(new Ui::MainWindow)
 {
+    // Remote sources are polled, local sources are watched
+    pollInterval_ = MinPollInterval;
+    updateTimer_ = new QTimer(this);
+    updateTimer_->setSingleShot(true);
+    connect(updateTimer_, &QTimer::timeout, [=]() { checkForUpdates(); });
+    journalWatcher_ = new QFileSystemWatcher(this);
+    watchDebounce_ = new QTimer(this);
+    watchDebounce_->setSingleShot(true);
+    watchDebounce_->setInterval(250);
+    connect(journalWatcher_, &QFileSystemWatcher::fileChanged, [=]() { watchDebounce_->start(); });
+    connect(journalWatcher_, &QFileSystemWatcher::directoryChanged, [=]() { watchDebounce_->start(); });
+    connect(watchDebounce_, &QTimer::timeout, [=]() { localJournalChanged(); });
+
     ui_->setupUi(this);
     initialiseElements();
-
-    QTimer *timer = new QTimer(this);
-    connect(timer, &QTimer::timeout, [=]() { checkForUpdates(); });
-    timer->start(30000);
+    if (localSource_.isEmpty())
+        updateTimer_->start(pollInterval_);
 }
 
 MainWindow::~MainWindow() { delete ui_; }
@@ -88,14 +109,23 @@ void MainWindow::initialiseElements()
     // Connect exit action
     connect(ui_->action_Quit, SIGNAL(triggered()), this, SLOT(close()));
 
+    dataCache_.setMaxMegabytes(settings.value("cacheSize", dataCache_.maxMegabytes()).toInt());
+
+    // Plot tabs beyond the memory budget are hibernated, least recently shown first
+    plotMemoryBudget_ = settings.value("plotMemoryBudget", DefaultPlotMemoryBudget).toInt();
+    connect(ui_->tabWidget, SIGNAL(currentChanged(int)), this, SLOT(tabActivated(int)));
+    memoryTimer_ = new QTimer(this);
+    connect(memoryTimer_, &QTimer::timeout, [=]() { enforceMemoryBudget(); });
+    memoryTimer_->start(MemoryCheckInterval);
+
     // Tests and assigns local sources from memory
-    QString localSource = settings.value("localSource").toString();
+    localSource_ = settings.value("localSource").toString();
     QString url_str;
     validSource_ = true;
-    if (!localSource.isEmpty())
+    if (localSource_.isEmpty())
         url_str = "http://127.0.0.1:5000/clearLocalSource";
     else
-        url_str = "http://127.0.0.1:5000/setLocalSource/" + localSource.replace("/", ";");
+        url_str = "http://127.0.0.1:5000/setLocalSource/" + QString(localSource_).replace("/", ";");
     HttpRequestInput input(url_str);
     auto *worker = new HttpRequestWorker(this);
     worker->execute(input);
@@ -504,6 +534,8 @@ void MainWindow::on_actionMountPoint_triggered()
 
     QSettings settings(QSettings::IniFormat, QSettings::UserScope, "ISIS", "jv2");
     settings.setValue("mountPoint", textInput);
+    // Cached blocks came from the previous archive
+    dataCache_.clear();
 
     QString url_str = "http://127.0.0.1:5000/setRoot/";
     url_str += textInput;
@@ -516,6 +548,7 @@ void MainWindow::on_actionClearMountPoint_triggered()
 {
     QSettings settings(QSettings::IniFormat, QSettings::UserScope, "ISIS", "jv2");
     settings.setValue("mountPoint", "");
+    dataCache_.clear();
 
     QString url_str = "http://127.0.0.1:5000/setRoot/Default";
     HttpRequestInput input(url_str);
@@ -523,6 +556,33 @@ void MainWindow::on_actionClearMountPoint_triggered()
     worker->execute(input);
 }
 
+void MainWindow::on_actionCacheSize_triggered()
+{
+    bool valid;
+    auto cacheSize = QInputDialog::getInt(this, tr("Set data cache size"), tr("Cache size (MB):"),
+                                          dataCache_.maxMegabytes(), 0, 65536, 64, &valid);
+    if (!valid)
+        return;
+
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, "ISIS", "jv2");
+    settings.setValue("cacheSize", cacheSize);
+    dataCache_.setMaxMegabytes(cacheSize);
+}
+
+void MainWindow::on_actionPlotMemoryBudget_triggered()
+{
+    bool valid;
+    auto budget = QInputDialog::getInt(this, tr("Set plot memory budget"), tr("Plot memory budget (MB):"),
+                                       plotMemoryBudget_, 16, 65536, 64, &valid);
+    if (!valid)
+        return;
+
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, "ISIS", "jv2");
+    settings.setValue("plotMemoryBudget", budget);
+    plotMemoryBudget_ = budget;
+    enforceMemoryBudget();
+}
+
 void MainWindow::setLoadScreen(bool state)
 {
     if (state)
@@ -542,17 +602,91 @@ void MainWindow::checkForUpdates()
     QString url_str = "http://127.0.0.1:5000/pingCycle/" + instName_;
     HttpRequestInput input(url_str);
     auto *worker = new HttpRequestWorker(this);
-    connect(worker, &HttpRequestWorker::on_execution_finished,
-            [=](HttpRequestWorker *workerProxy) { refresh(workerProxy->response); });
+    connect(worker, &HttpRequestWorker::on_execution_finished, [=](HttpRequestWorker *workerProxy) {
+        refresh(workerProxy->response);
+        schedulePoll(!workerProxy->response.isEmpty());
+    });
     worker->execute(input);
 }
 
+// Queue the next archive poll, backing off while idle or minimised
+void MainWindow::schedulePoll(bool changed)
+{
+    if (!localSource_.isEmpty())
+    {
+        updateTimer_->stop();
+        return;
+    }
+    if (changed)
+        pollInterval_ = MinPollInterval;
+    else
+        pollInterval_ = std::min(pollInterval_ * 2, MaxPollInterval);
+    updateTimer_->start(isMinimized() ? MaxPollInterval : pollInterval_);
+}
+
+void MainWindow::changeEvent(QEvent *event)
+{
+    if (localSource_.isEmpty())
+    {
+        // Maximising or restoring a shown window leaves polling as it is
+        auto restored = event->type() == QEvent::WindowStateChange &&
+                        (static_cast<QWindowStateChangeEvent *>(event)->oldState() & Qt::WindowMinimized);
+        auto activated = event->type() == QEvent::ActivationChange && isActiveWindow();
+        if (event->type() == QEvent::WindowStateChange && isMinimized())
+            updateTimer_->start(MaxPollInterval);
+        else if (restored || (activated && (pollInterval_ > MinPollInterval || !updateTimer_->isActive())))
+        {
+            // Catch up straight away when brought back after backing off
+            pollInterval_ = MinPollInterval;
+            checkForUpdates();
+        }
+    }
+    QMainWindow::changeEvent(event);
+}
+
+// Watch the local journal directory and displayed cycle file for new runs
+void MainWindow::watchLocalSource()
+{
+    if (!journalWatcher_->files().isEmpty())
+        journalWatcher_->removePaths(journalWatcher_->files());
+    if (!journalWatcher_->directories().isEmpty())
+        journalWatcher_->removePaths(journalWatcher_->directories());
+
+    if (localSource_.isEmpty())
+    {
+        if (!updateTimer_->isActive())
+            updateTimer_->start(pollInterval_);
+        return;
+    }
+    updateTimer_->stop();
+
+    auto journalDir = localSource_ + "ndx" + instName_ + "/";
+    if (!QDir(journalDir).exists())
+        return;
+    journalWatcher_->addPath(journalDir);
+    auto cycle = cyclesMap_.value(ui_->cycleButton->text());
+    if (!cycle.isEmpty() && QFile::exists(journalDir + cycle))
+        journalWatcher_->addPath(journalDir + cycle);
+}
+
+void MainWindow::localJournalChanged()
+{
+    auto cycles =
+        QDir(localSource_ + "ndx" + instName_).entryList(QStringList("journal_*_*.xml"), QDir::Files, QDir::Name);
+    if (!cycles.isEmpty() && !cyclesMap_.values().contains(cycles.last()))
+        refresh(cycles.last()); // new cycle file
+    else
+        updateCurrentCycle();
+
+    // Re-arm, as journals rewritten by replacement drop out of the watcher
+    watchLocalSource();
+}
+
 void MainWindow::refresh(QString status)
 {
     if (status != "")
     {
         qDebug() << "Update";
-        currentInstrumentChanged(instName_);
         if (cyclesMap_[cyclesMenu_->actions()[0]->text()] != status) // if new cycle found
         {
             auto displayName = "Cycle " + status.split("_")[1] + "/" + status.split("_")[2].remove(".xml");
@@ -563,15 +697,7 @@ void MainWindow::refresh(QString status)
             cyclesMenu_->insertAction(cyclesMenu_->actions()[0], action);
         }
         else if (cyclesMap_[ui_->cycleButton->text()] == status) // if current opened cycle changed
-        {
-            QString url_str = "http://127.0.0.1:5000/updateJournal/" + instName_ + "/" + status + "/" +
-                              model_->getJsonObject(model_->index(model_->rowCount() - 1, 0))["run_number"].toString();
-            HttpRequestInput input(url_str);
-            auto *worker = new HttpRequestWorker(this);
-            connect(worker, &HttpRequestWorker::on_execution_finished,
-                    [=](HttpRequestWorker *workerProxy) { update(workerProxy); });
-            worker->execute(input);
-        }
+            updateCurrentCycle();
     }
     else
     {
@@ -580,15 +706,31 @@ void MainWindow::refresh(QString status)
     }
 }
 
+// Fetch only the runs added to the displayed cycle since the last load
+void MainWindow::updateCurrentCycle()
+{
+    auto cycle = cyclesMap_.value(ui_->cycleButton->text());
+    if (cycle.isEmpty())
+        return;
+
+    QString url_str = "http://127.0.0.1:5000/updateJournal/" + instName_ + "/" + cycle + "/" +
+                      QString::number(model_->lastRunNumber());
+    HttpRequestInput input(url_str);
+    auto *worker = new HttpRequestWorker(this);
+    auto *model = model_;
+    connect(worker, &HttpRequestWorker::on_execution_finished, [=](HttpRequestWorker *workerProxy) {
+        // Discard the delta if the table was reloaded in the meantime
+        if (model == model_)
+            update(workerProxy);
+    });
+    worker->execute(input);
+}
+
 void MainWindow::update(HttpRequestWorker *worker)
 {
-    for (auto row : worker->jsonArray)
-    {
-        auto rowObject = row.toObject();
-        model_->insertRows(model_->rowCount(), 1);
-        auto index = model_->index(model_->rowCount() - 1, 0);
-        model_->setData(index, rowObject);
-    }
+    if (worker->errorType != QNetworkReply::NoError)
+        return;
+    model_->appendJson(worker->jsonArray);
 }
 
 void MainWindow::on_actionSetLocalSource_triggered()
@@ -599,6 +741,7 @@ void MainWindow::on_actionSetLocalSource_triggered()
 
     QSettings settings(QSettings::IniFormat, QSettings::UserScope, "ISIS", "jv2");
     settings.setValue("localSource", textInput);
+    localSource_ = textInput;
 
     QString msg = "If table fails to load, the local source cannot be found";
     QMessageBox::information(this, "", msg);
@@ -614,6 +757,7 @@ void MainWindow::on_actionClearLocalSource_triggered()
 {
     QSettings settings(QSettings::IniFormat, QSettings::UserScope, "ISIS", "jv2");
     settings.setValue("localSource", "");
+    localSource_ = "";
 
     QString url_str = "http://127.0.0.1:5000/clearLocalSource";
     HttpRequestInput input(url_str);
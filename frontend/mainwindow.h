@@ -4,14 +4,23 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "datacache.h"
 #include "httprequestworker.h"
 #include "jsontablemodel.h"
+#include "logdata.h"
 #include "mysortfilterproxymodel.h"
 #include <QChart>
 #include <QCheckBox>
 #include <QDomDocument>
+#include <QFileSystemWatcher>
+#include <QHash>
 #include <QMainWindow>
 #include <QSortFilterProxyModel>
+#include <QTimer>
+#include <functional>
+
+class ChartView;
+class GraphWidget;
 
 QT_BEGIN_NAMESPACE
 namespace Ui
@@ -38,6 +47,19 @@ class MainWindow : public QMainWindow
     QString getRunNos();
     QDomDocument getConfig();
     void checkForUpdates();
+    void updateCurrentCycle();
+    void watchLocalSource();
+    // Background fetches pass failed, which replaces the error message
+    void fetchRunBlocks(QString source, QString cycles, QStringList runs, QString item,
+                        std::function<void(QJsonArray, QJsonArray)> handler, std::function<void()> failed = nullptr);
+    void fetchSpectrum(QString cycle, QString runs, int spectrum, int spectraCount, std::function<void(QJsonArray)> handler);
+    // Plot tab memory, in bytes, and hibernation
+    QList<ChartView *> tabChartViews(QWidget *tab);
+    qint64 tabMemory(QWidget *tab);
+    bool isTabHibernated(QWidget *tab);
+    bool canHibernateTab(QWidget *tab);
+    void setTabHibernated(QWidget *tab, bool hibernated);
+    void enforceMemoryBudget();
 
     private slots:
     // Search Controls
@@ -74,15 +96,36 @@ class MainWindow : public QMainWindow
     void on_groupButton_clicked(bool checked);
     // Visualisation
     void customMenuRequested(QPoint pos);
-    void handle_result_contextGraph(HttpRequestWorker *worker);
+    QWidget *createLogWindow(QString tabName);
+    void addLogData(QWidget *window, QJsonArray fields, LogData logData);
+    // Fetch finer tiles of long logs for the range a log window shows
+    void refineLogTiles(QWidget *window);
+    // Full path of a log window field from the name its series carry
+    QString logFieldPath(QWidget *window, const QString &field);
+    // Fetch the whole log of a tiled field, for derived channels and the envelope
+    void fetchLogSamples(QWidget *window, const QString &run, const QString &field);
+    void fetchEnvelopeSamples(QWidget *window);
+    // Add derived channels for runs that now have every field they read
+    void updateDerivedChannels(QWidget *window);
+    // Fetch samples of a live log window's latest run recorded since those plotted
+    void pollLiveTail(QWidget *window);
     void contextGraph();
     void handle_result_contextMenu(HttpRequestWorker *worker);
     void toggleAxis(int state);
     void getField();
+    // Plot a log window's field against another, joined by time
+    void correlateField();
+    // Add a channel computed from a log window's fields
+    void addDerivedChannel(QWidget *window);
     void showStatus(qreal x, qreal y, QString title);
 
-    void handleSpectraCharting(HttpRequestWorker *worker);
-    void handleMonSpectraCharting(HttpRequestWorker *worker);
+    GraphWidget *handleSpectraCharting(QString type, QString runs, QString spectrum, QJsonArray blocks);
+    void changeSpectrum(QString runs, int spectrum);
+    void openSpectrumBrowser(QString cycle, QString runs, int spectrum, int spectraCount);
+    void plotDetectorHeatmap();
+    void aggregateSpectra();
+    void findRunPeaks();
+    void plotAggregateSpectrum(QString cycle, QString runs, int first, int count, bool average, bool weighted);
     void plotSpectra(HttpRequestWorker *count);
     void plotMonSpectra(HttpRequestWorker *count);
     void getSpectrumCount();
@@ -93,17 +136,25 @@ class MainWindow : public QMainWindow
     void runDivide(QString currentDetector, QString run, bool checked);
     void monDivide(QString currentRun, QString mon, bool checked);
 
+    // Unit conversion
+    void flightPaths(QString type, QString runs, QString spectrum);
+
     // Misc Interface Functions
     void removeTab(int index);
+    void tabActivated(int index);
     void savePref();
     void clearPref();
     void columnHider(int state);
 
     void on_actionMountPoint_triggered();
     void on_actionClearMountPoint_triggered();
+    void on_actionCacheSize_triggered();
+    void on_actionPlotMemoryBudget_triggered();
 
     void refresh(QString Status);
     void update(HttpRequestWorker *worker);
+    void schedulePoll(bool changed);
+    void localJournalChanged();
     void on_actionSetLocalSource_triggered();
     void on_actionClearLocalSource_triggered();
     void refreshTable();
@@ -112,6 +163,7 @@ class MainWindow : public QMainWindow
     // Window close event
     void closeEvent(QCloseEvent *event);
     void keyPressEvent(QKeyEvent *event);
+    void changeEvent(QEvent *event);
 
     signals:
     void tableFilled();
@@ -144,5 +196,19 @@ class MainWindow : public QMainWindow
     bool validSource_;
     QPoint pos_;
     QList<std::tuple<HttpRequestWorker *, QString>> cachedMassSearch_;
+    // Update checking
+    QString localSource_;
+    QTimer *updateTimer_;
+    QTimer *watchDebounce_;
+    QFileSystemWatcher *journalWatcher_;
+    int pollInterval_;
+    // Per-run spectra and log blocks already fetched
+    DataCache dataCache_;
+    // Handlers waiting on spectrum block requests in flight
+    QHash<QString, QList<std::function<void(QVector<QJsonArray>)>>> pendingSpectrumBlocks_;
+    // Plot tabs, most recently shown first, and the memory (MB) they may hold before older ones are hibernated
+    QList<QWidget *> tabHistory_;
+    int plotMemoryBudget_;
+    QTimer *memoryTimer_;
 };
 #endif // MAINWINDOW_H
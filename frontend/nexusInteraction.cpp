@@ -3,24 +3,55 @@
 
 #include "./ui_mainwindow.h"
 #include "chartview.h"
+#include "derivedchannels.h"
+#include "detectorcounts.h"
 #include "graphwidget.h"
+#include "heatmapwidget.h"
+#include "livetail.h"
+#include "logjoin.h"
+#include "logtiles.h"
 #include "mainwindow.h"
+#include "peakfinder.h"
+#include "requestqueue.h"
 #include <QAction>
 #include <QCategoryAxis>
 #include <QChartView>
+#include <QCheckBox>
+#include <QComboBox>
 #include <QDateTimeAxis>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QElapsedTimer>
+#include <QFormLayout>
+#include <QFutureWatcher>
 #include <QInputDialog>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QLabel>
+#include <QLegendMarker>
 #include <QLineSeries>
 #include <QMessageBox>
 #include <QNetworkReply>
+#include <QPointer>
+#include <QScatterSeries>
 #include <QSettings>
+#include <QSpinBox>
 #include <QTabWidget>
 #include <QValueAxis>
 #include <QWidgetAction>
+#include <QtConcurrent>
 #include <algorithm>
+#include <limits>
+#include <numeric>
+
+// Run data requests in flight at once for a log plot
+const int MaxLogRequests = 4;
+// Detector spectra fetched per request when browsing
+const int SpectrumBlockSize = 64;
+// Runs of detector counts in flight at once when aggregating, as each may be hundreds of MB
+const int MaxCountRequests = 2;
 
 // Collect plot options and display menu
 void MainWindow::customMenuRequested(QPoint pos)
@@ -94,6 +125,18 @@ void MainWindow::handle_result_contextMenu(HttpRequestWorker *worker)
         auto *action3 = new QAction("Plot monitor spectrum", this);
         connect(action3, SIGNAL(triggered()), this, SLOT(getMonitorCount()));
         contextMenu_->addAction(action3);
+
+        auto *action4 = new QAction("Plot detector counts map", this);
+        connect(action4, SIGNAL(triggered()), this, SLOT(plotDetectorHeatmap()));
+        contextMenu_->addAction(action4);
+
+        auto *action5 = new QAction("Aggregate detector spectra...", this);
+        connect(action5, SIGNAL(triggered()), this, SLOT(aggregateSpectra()));
+        contextMenu_->addAction(action5);
+
+        auto *action6 = new QAction("Find peaks in all detector spectra", this);
+        connect(action6, SIGNAL(triggered()), this, SLOT(findRunPeaks()));
+        contextMenu_->addAction(action6);
     }
     else
     {
@@ -175,43 +218,218 @@ void MainWindow::contextGraph()
     // Error handling
     if (runNos.size() == 0)
         return;
-    QString url_str = "http://127.0.0.1:5000/getNexusData/";
 
+    // Request each run separately so curves are drawn as their files are read, plotting cached runs at once. Logs
+    // come as their whole span tile, which long logs refine as they are zoomed (see refineLogTiles)
     QString field = contextAction->data().toString().replace("/", ":");
-    url_str += instName_ + "/" + cycles + "/" + runNos + "/" + field;
+    auto runList = runNos.split(";");
+    auto cycleList = cycles.split(";");
+    QStringList urls;
+    QStringList queuedRuns;
+    QStringList queuedKeys;
+    QStringList cachedKeys;
+    for (auto i = 0; i < runList.size(); ++i)
+    {
+        auto cycle = cycleList.value(i, " ");
+        auto key = DataCache::key("getLogTile", instName_, cycle, runList[i], field + "/0/0");
+        // The header fills the fields menu, and may have been evicted apart from the block
+        if (dataCache_.contains(key) && dataCache_.contains(key + ":header"))
+        {
+            cachedKeys.append(key);
+            continue;
+        }
+        urls.append("http://127.0.0.1:5000/getLogTile/" + instName_ + "/" + cycle + "/" + runList[i] + "/" + field +
+                    "/0/0");
+        queuedRuns.append(runList[i]);
+        queuedKeys.append(key);
+    }
 
-    HttpRequestInput input(url_str);
-    auto *worker = new HttpRequestWorker(this);
-    connect(worker, SIGNAL(on_execution_finished(HttpRequestWorker *)), this,
-            SLOT(handle_result_contextGraph(HttpRequestWorker *)));
-    setLoadScreen(true);
-    worker->execute(input);
+    auto *window = createLogWindow(field.section(':', -1));
+    window->setProperty("field", field);
+    window->setProperty("fields", QStringList({field}));
+    window->findChild<LogTiles *>("logTiles")->setCycles(runList, cycleList);
+    auto *statusLabel = window->findChild<QLabel *>("statusLabel");
+    auto *cancelButton = window->findChild<QPushButton *>("cancelButton");
+    auto *queue = new RequestQueue(urls, MaxLogRequests, window);
+    auto failed = QSharedPointer<QStringList>::create();
+
+    auto updateStatus = [=]() {
+        QString status;
+        if (queue->isActive())
+            status = "Loading runs: " + QString::number(queue->completed()) + "/" + QString::number(queue->count());
+        else if (queue->completed() < queue->count())
+            status = "Cancelled after " + QString::number(queue->completed()) + "/" + QString::number(queue->count()) +
+                     " runs";
+        if (!failed->isEmpty())
+            status += (status.isEmpty() ? "" : ", ") + QString("failed: ") + failed->join(", ");
+        statusLabel->setText(status);
+        statusLabel->setVisible(!status.isEmpty());
+        cancelButton->setVisible(queue->isActive());
+    };
+
+    // Parse off the GUI thread, then add to the plot
+    auto plotRun = [=](QJsonArray fields, QJsonArray runBlock) {
+        auto *watcher = new QFutureWatcher<LogData>(window);
+        connect(watcher, &QFutureWatcher<LogData>::finished, [=]() {
+            addLogData(window, fields, watcher->result());
+            watcher->deleteLater();
+        });
+        watcher->setFuture(QtConcurrent::run(&LogData::fromJson, QJsonArray({runBlock})));
+    };
+    for (const auto &key : cachedKeys)
+        plotRun(dataCache_.value(key + ":header"), dataCache_.value(key));
+
+    connect(queue, &RequestQueue::requestFinished, [=](int index, HttpRequestWorker *worker) {
+        if (worker->errorType != QNetworkReply::NoError || worker->jsonArray.size() < 2)
+        {
+            failed->append(queuedRuns[index]);
+            updateStatus();
+            return;
+        }
+        auto fields = worker->jsonArray[0].toArray();
+        auto runBlock = worker->jsonArray[1].toArray();
+        dataCache_.insert(queuedKeys[index] + ":header", fields);
+        dataCache_.insert(queuedKeys[index], runBlock);
+        plotRun(fields, runBlock);
+        updateStatus();
+    });
+    connect(queue, &RequestQueue::finished, updateStatus);
+    connect(cancelButton, &QPushButton::clicked, [=]() {
+        queue->cancel();
+        updateStatus();
+    });
+
+    updateStatus();
+    queue->start();
 }
 
-// Configure and populate graphing window
-void MainWindow::handle_result_contextGraph(HttpRequestWorker *worker)
+// Create an empty graphing window, populated by addLogData as run data arrives
+QWidget *MainWindow::createLogWindow(QString tabName)
 {
-    setLoadScreen(false);
     auto *window = new QWidget;
     auto *dateTimeChart = new QChart();
     auto *dateTimeChartView = new ChartView(dateTimeChart, window);
     auto *relTimeChart = new QChart();
     auto *relTimeChartView = new ChartView(relTimeChart, window);
     auto *fieldsMenu = new QMenu("fieldsMenu", window);
+    fieldsMenu->setObjectName("fieldsMenu");
+    auto *correlateMenu = new QMenu("correlateMenu", window);
+    correlateMenu->setObjectName("correlateMenu");
+    new DerivedChannels(window);
+    new LogTiles(window);
+    auto *liveTail = new LiveTail(window);
+    connect(liveTail, &LiveTail::pollDue, [=]() { pollLiveTail(window); });
+
+    auto *timeAxis = new QDateTimeAxis();
+    timeAxis->setFormat("yyyy-MM-dd<br>H:mm:ss");
+    dateTimeChart->addAxis(timeAxis, Qt::AlignBottom);
+
+    auto *relTimeXAxis = new QValueAxis();
+    relTimeXAxis->setTitleText("Relative Time (s)");
+    relTimeChart->addAxis(relTimeXAxis, Qt::AlignBottom);
+
+    // Replaced by category axes if the first data to arrive is string valued
+    auto *dateTimeYAxis = new QValueAxis();
+    auto *relTimeYAxis = new QValueAxis();
+    dateTimeYAxis->setTitleText(tabName);
+    relTimeYAxis->setTitleText(tabName);
+    dateTimeChart->addAxis(dateTimeYAxis, Qt::AlignLeft);
+    relTimeChart->addAxis(relTimeYAxis, Qt::AlignLeft);
+
+    connect(dateTimeChartView, SIGNAL(showCoordinates(qreal, qreal, QString)), this, SLOT(showStatus(qreal, qreal, QString)));
+    connect(dateTimeChartView, SIGNAL(clearCoordinates()), statusBar(), SLOT(clearMessage()));
+    connect(relTimeChartView, SIGNAL(showCoordinates(qreal, qreal, QString)), this, SLOT(showStatus(qreal, qreal, QString)));
+    connect(relTimeChartView, SIGNAL(clearCoordinates()), statusBar(), SLOT(clearMessage()));
+    connect(dateTimeChartView, &ChartView::viewChanged, [=]() { refineLogTiles(window); });
+    connect(relTimeChartView, &ChartView::viewChanged, [=]() { refineLogTiles(window); });
+
+    auto *gridLayout = new QGridLayout(window);
+    auto *axisToggleCheck = new QCheckBox("Plot relative to run start times", window);
+    auto *envelopeCheck = new QCheckBox("Envelope of runs", window);
+    envelopeCheck->setObjectName("envelopeCheck");
+    auto *outliersCheck = new QCheckBox("Show outlying runs", window);
+    // Runs only overlap in time relative to their starts, so the envelope is drawn on that view alone
+    envelopeCheck->setEnabled(false);
+    outliersCheck->setEnabled(false);
+    auto *statusLabel = new QLabel(window);
+    statusLabel->setObjectName("statusLabel");
+    auto *cancelButton = new QPushButton("Cancel", window);
+    cancelButton->setObjectName("cancelButton");
+    cancelButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    auto *addFieldButton = new QPushButton("Add field", window);
+    auto *correlateButton = new QPushButton("Plot against field", window);
+    correlateButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    auto *deriveButton = new QPushButton("Add derived channel", window);
+    deriveButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    auto *liveCheck = new QCheckBox("Live", window);
+    liveCheck->setToolTip("Follow the latest run, fetching its new samples periodically");
+
+    addFieldButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
+    connect(axisToggleCheck, SIGNAL(stateChanged(int)), this, SLOT(toggleAxis(int)));
+    connect(axisToggleCheck, &QCheckBox::toggled, [=](bool relative) {
+        if (!relative)
+            envelopeCheck->setChecked(false);
+        envelopeCheck->setEnabled(relative);
+    });
+    connect(envelopeCheck, &QCheckBox::toggled, outliersCheck, &QCheckBox::setEnabled);
+    auto setEnvelope = [=]() {
+        if (envelopeCheck->isChecked())
+            fetchEnvelopeSamples(window);
+        relTimeChartView->setEnvelope(envelopeCheck->isChecked(), outliersCheck->isChecked());
+    };
+    connect(envelopeCheck, &QCheckBox::toggled, setEnvelope);
+    connect(outliersCheck, &QCheckBox::toggled, setEnvelope);
+    connect(addFieldButton, &QPushButton::clicked,
+            [=]() { fieldsMenu->exec(addFieldButton->mapToGlobal(QPoint(0, addFieldButton->height()))); });
+    connect(correlateButton, &QPushButton::clicked,
+            [=]() { correlateMenu->exec(correlateButton->mapToGlobal(QPoint(0, correlateButton->height()))); });
+    connect(deriveButton, &QPushButton::clicked, [=]() { addDerivedChannel(window); });
+    connect(liveCheck, &QCheckBox::toggled, liveTail, &LiveTail::setActive);
+
+    gridLayout->addWidget(dateTimeChartView, 1, 0, -1, -1);
+    gridLayout->addWidget(relTimeChartView, 1, 0, -1, -1);
+    relTimeChartView->hide();
+    gridLayout->addWidget(axisToggleCheck, 0, 0);
+    gridLayout->addWidget(envelopeCheck, 0, 1);
+    gridLayout->addWidget(outliersCheck, 0, 2);
+    gridLayout->addWidget(statusLabel, 0, 3);
+    gridLayout->addWidget(cancelButton, 0, 4);
+    gridLayout->addWidget(addFieldButton, 0, 5);
+    gridLayout->addWidget(correlateButton, 0, 6);
+    gridLayout->addWidget(deriveButton, 0, 7);
+    gridLayout->addWidget(liveCheck, 0, 8);
+    gridLayout->setColumnStretch(0, 1);
+    ui_->tabWidget->addTab(window, tabName);
+    ui_->tabWidget->setTabToolTip(ui_->tabWidget->count() - 1, instDisplayName_ + "\n" + tabName);
+    ui_->tabWidget->setCurrentIndex(ui_->tabWidget->count() - 1);
+    dateTimeChartView->setFocus();
+    return window;
+}
 
-    QString msg;
-    if (worker->errorType == QNetworkReply::NoError)
+// Add parsed log data to a graphing window
+void MainWindow::addLogData(QWidget *window, QJsonArray fields, LogData logData)
+{
+    auto tabCharts = window->findChildren<ChartView *>();
+
+    // Fill the fields menu from the first response to arrive
+    auto *fieldsMenu = window->findChild<QMenu *>("fieldsMenu");
+    auto *correlateMenu = window->findChild<QMenu *>("correlateMenu");
+    if (fieldsMenu->isEmpty())
     {
-        foreach (const QJsonValue &log, worker->jsonArray[0].toArray())
+        foreach (const QJsonValue &log, fields)
         {
             auto logArray = log.toArray();
             auto name = logArray.first().toString().toUpper();
             name.chop(2);
             auto formattedName = name.append("og");
             auto *subMenu = new QMenu("Add data from " + formattedName);
+            auto *correlateSubMenu = new QMenu(formattedName, correlateMenu);
             logArray.removeFirst();
             if (logArray.size() > 0)
+            {
                 fieldsMenu->addMenu(subMenu);
+                correlateMenu->addMenu(correlateSubMenu);
+            }
 
             auto logArrayVar = logArray.toVariantList();
             std::sort(logArrayVar.begin(), logArrayVar.end(),
@@ -225,228 +443,402 @@ void MainWindow::handle_result_contextGraph(HttpRequestWorker *worker)
                 action->setData(path);
                 connect(action, SIGNAL(triggered()), this, SLOT(getField()));
                 subMenu->addAction(action);
+                auto *correlateAction = new QAction(action->text(), correlateSubMenu);
+                correlateAction->setData(path);
+                connect(correlateAction, &QAction::triggered, this, &MainWindow::correlateField);
+                correlateSubMenu->addAction(correlateAction);
             }
         }
+    }
 
-        worker->jsonArray.removeFirst();
-        auto *timeAxis = new QDateTimeAxis();
-        timeAxis->setFormat("yyyy-MM-dd<br>H:mm:ss");
-        dateTimeChart->addAxis(timeAxis, Qt::AlignBottom);
+    // Index string values against the labels already on the category axis, switching an empty chart over to one
+    if (!logData.categories.isEmpty())
+    {
+        for (auto *chartView : tabCharts)
+        {
+            auto *chart = chartView->chart();
+            auto *yAxis = chart->axes(Qt::Vertical)[0];
+            QStringList labels;
+            if (yAxis->type() == QAbstractAxis::AxisTypeCategory)
+                labels = qobject_cast<QCategoryAxis *>(yAxis)->categoriesLabels();
+            else if (!chart->series().isEmpty())
+                continue;
+            auto previousCount = labels.count();
+            logData.mergeCategories(labels);
+
+            QCategoryAxis *categoryAxis;
+            if (yAxis->type() == QAbstractAxis::AxisTypeCategory)
+                categoryAxis = qobject_cast<QCategoryAxis *>(yAxis);
+            else
+            {
+                categoryAxis = new QCategoryAxis();
+                categoryAxis->setTitleText(yAxis->titleText());
+                categoryAxis->setLabelsPosition(QCategoryAxis::AxisLabelsPositionOnValue);
+                chart->removeAxis(yAxis);
+                delete yAxis;
+                chart->addAxis(categoryAxis, Qt::AlignLeft);
+            }
+            for (auto i = previousCount; i < labels.count(); ++i)
+                categoryAxis->append(labels[i], i);
+            categoryAxis->setRange(0, labels.count() - 1);
+        }
+    }
 
-        auto *dateTimeYAxis = new QValueAxis();
-        dateTimeYAxis->setRange(0, 0);
+    window->findChild<LogTiles *>("logTiles")->addSeries(logData.series);
+    window->findChild<LiveTail *>("liveTail")->addSeries(logData.series);
 
-        auto *dateTimeStringAxis = new QCategoryAxis();
-        QStringList categoryValues;
+    window->findChild<DerivedChannels *>("derivedChannels")->addSeries(logData.series);
+    for (auto *chartView : tabCharts)
+        chartView->addLogSeries(logData.series);
+    // Derive channels for any runs this completes
+    updateDerivedChannels(window);
+    if (window->findChild<QCheckBox *>("envelopeCheck")->isChecked())
+        fetchEnvelopeSamples(window);
 
-        auto *relTimeXAxis = new QValueAxis();
-        relTimeXAxis->setTitleText("Relative Time (s)");
-        relTimeChart->addAxis(relTimeXAxis, Qt::AlignBottom);
+    QString runs;
+    for (auto series : tabCharts[0]->chart()->series())
+        if (series->objectName() != "envelope")
+            runs.append(series->name() + ", ");
+    runs.chop(2);
+    auto index = ui_->tabWidget->indexOf(window);
+    if (index != -1)
+        ui_->tabWidget->setTabToolTip(index, instDisplayName_ + "\n" + ui_->tabWidget->tabText(index) + "\n" + runs);
+}
 
-        auto *relTimeYAxis = new QValueAxis();
+// Fetch finer tiles of a log window's long logs for the range in view, swapping each run's data as they arrive
+void MainWindow::refineLogTiles(QWidget *window)
+{
+    auto *logTiles = window->findChild<LogTiles *>("logTiles");
+    QVector<LogTiles::Tile> tiles;
+    for (auto *chartView : window->findChildren<ChartView *>())
+    {
+        if (!chartView->isVisible())
+            continue;
+        auto pixels = (int)chartView->chart()->plotArea().width();
+        for (auto *series : chartView->chart()->series())
+        {
+            auto *xySeries = qobject_cast<QXYSeries *>(series);
+            double first;
+            double last;
+            auto field = series->property("field").toString();
+            if (xySeries && logTiles->isTiled(series->name(), field) && chartView->seriesRange(xySeries, first, last))
+                tiles.append(logTiles->wanted(series->name(), field, first, last, pixels));
+        }
+    }
 
-        auto *relTimeStringAxis = new QCategoryAxis();
+    QPointer<QWidget> target = window;
+    for (const auto &tile : tiles)
+        fetchRunBlocks("getLogTile", logTiles->cycle(tile.run), {tile.run},
+                       logFieldPath(window, tile.field) + "/" + LogTiles::item(tile),
+                       [=](QJsonArray, QJsonArray runs) {
+                           if (!target)
+                               return;
+                           auto logData = LogData::fromJson(runs);
+                           if (logData.series.isEmpty())
+                           {
+                               logTiles->dropRequest(tile);
+                               return;
+                           }
+                           auto data = logTiles->addTile(tile, logData.series.first().data);
+                           if (!data)
+                               return;
+                           for (auto *chartView : target->findChildren<ChartView *>())
+                               for (auto *series : chartView->chart()->series())
+                                   if (series->name() == tile.run && series->property("field").toString() == tile.field)
+                                       chartView->replaceSeriesData(qobject_cast<QXYSeries *>(series), data);
+                       },
+                       // Tiles refine a plot already drawn, so a failed one is dropped quietly to be asked for again
+                       [=]() {
+                           if (target)
+                               logTiles->dropRequest(tile);
+                       });
+}
 
-        QList<QString> chartFields;
-        bool firstRun = true;
-        // For each Run
-        foreach (const auto &runFields, worker->jsonArray)
-        {
-            auto runFieldsArray = runFields.toArray();
+QString MainWindow::logFieldPath(QWidget *window, const QString &field)
+{
+    for (const auto &path : window->property("fields").toStringList())
+        if (path.section(':', -1) == field)
+            return path;
+    return QString();
+}
 
-            auto startTime = QDateTime::fromString(runFieldsArray.first()[0].toString(), "yyyy-MM-dd'T'HH:mm:ss");
-            auto endTime = QDateTime::fromString(runFieldsArray.first()[1].toString(), "yyyy-MM-dd'T'HH:mm:ss");
-            runFieldsArray.removeFirst();
+// Fetch the whole log of a tiled field once, handing it to the derived channels and to the envelope of each view
+void MainWindow::fetchLogSamples(QWidget *window, const QString &run, const QString &field)
+{
+    auto *logTiles = window->findChild<LogTiles *>("logTiles");
+    auto path = logFieldPath(window, field);
+    if (path.isEmpty() || !logTiles->requestSamples(run, field))
+        return;
 
-            if (firstRun)
+    QPointer<QWidget> target = window;
+    // Runs whose log could not be had are asked for again on the next update, rather than reporting each failure
+    auto failed = [=]() {
+        if (target)
+            logTiles->dropSamplesRequest(run, field);
+    };
+    fetchRunBlocks("getNexusData", logTiles->cycle(run), {run}, path, [=](QJsonArray, QJsonArray runs) {
+        if (!target)
+            return;
+        auto *watcher = new QFutureWatcher<LogData>(target);
+        connect(watcher, &QFutureWatcher<LogData>::finished, [=]() {
+            auto logData = watcher->result();
+            watcher->deleteLater();
+            if (logData.series.isEmpty())
             {
-                timeAxis->setRange(startTime, endTime);
-                relTimeXAxis->setRange(0, 0);
+                failed();
+                return;
             }
+            auto samples = logData.series.first();
+            target->findChild<DerivedChannels *>("derivedChannels")->addSeries({samples});
+            updateDerivedChannels(target);
+            for (auto *chartView : target->findChildren<ChartView *>())
+                for (auto *series : chartView->chart()->series())
+                    if (series->name() == run && series->property("field").toString() == field)
+                        chartView->setEnvelopeData(qobject_cast<QXYSeries *>(series), samples.data);
+        });
+        watcher->setFuture(QtConcurrent::run(&LogData::fromJson, runs));
+    }, failed);
+}
 
-            foreach (const auto &fieldData, runFieldsArray)
-            {
-                auto fieldDataArray = fieldData.toArray();
-                fieldDataArray.removeFirst();
-                if (!fieldDataArray.first()[1].isString())
-                    break;
-                foreach (const auto &dataPair, fieldDataArray)
-                {
-                    auto dataPairArray = dataPair.toArray();
-                    categoryValues.append(dataPairArray[1].toString());
-                }
-            }
+// Fetch the whole logs of tiled series, which the envelope leaves out until they arrive
+void MainWindow::fetchEnvelopeSamples(QWidget *window)
+{
+    for (auto *chartView : window->findChildren<ChartView *>())
+        for (auto *series : chartView->chart()->series())
+            if (series->property("tiled").toBool())
+                fetchLogSamples(window, series->name(), series->property("field").toString());
+}
 
-            if (!categoryValues.isEmpty())
-            {
-                categoryValues.removeDuplicates();
-                categoryValues.sort();
-            }
-            if (firstRun)
-            {
-                if (!categoryValues.isEmpty())
-                {
-                    dateTimeChart->addAxis(dateTimeStringAxis, Qt::AlignLeft);
-                    relTimeChart->addAxis(relTimeStringAxis, Qt::AlignLeft);
-                }
-                else
-                {
-                    dateTimeChart->addAxis(dateTimeYAxis, Qt::AlignLeft);
-                    relTimeChart->addAxis(relTimeYAxis, Qt::AlignLeft);
-                }
-                firstRun = false;
-            }
-            // For each field
-            foreach (const auto &fieldData, runFieldsArray)
+// Fetch the samples of a log window's latest run recorded since those plotted, drawing them on as a continuation of
+// each field. Tails are not cached, as the run's file is still growing
+void MainWindow::pollLiveTail(QWidget *window)
+{
+    auto *liveTail = window->findChild<LiveTail *>("liveTail");
+    auto fields = window->property("fields").toStringList();
+    auto run = liveTail->run();
+    if (liveTail->isPending() || run.isEmpty() || fields.isEmpty())
+        return;
+    liveTail->setPending(true);
+
+    QString url = "http://127.0.0.1:5000/getLogTail/" + instName_ + "/" +
+                  window->findChild<LogTiles *>("logTiles")->cycle(run) + "/" + run + "/" + fields.join(";") + "/" +
+                  QString::number(liveTail->since(), 'g', 17);
+    HttpRequestInput input(url);
+    auto *worker = new HttpRequestWorker(this);
+    QPointer<QWidget> target = window;
+    connect(worker, &HttpRequestWorker::on_execution_finished, [=](HttpRequestWorker *workerProxy) {
+        workerProxy->deleteLater();
+        if (!target)
+            return;
+        liveTail->setPending(false);
+        // Failures are left for the next poll to retry
+        if (workerProxy->errorType != QNetworkReply::NoError)
+            return;
+        auto logData = LogData::fromJson(QJsonArray({workerProxy->jsonArray}));
+        for (const auto &field : liveTail->append(logData.series))
+        {
+            auto data = liveTail->data(field);
+            for (auto *chartView : target->findChildren<ChartView *>())
             {
-                auto fieldDataArray = fieldData.toArray();
-
-                // For each plot point
-                auto *dateSeries = new QLineSeries();
-                auto *relSeries = new QLineSeries();
-
-                connect(dateSeries, &QLineSeries::hovered, [=](const QPointF point, bool hovered) {
-                    dateTimeChartView->setHovered(point, hovered, dateSeries->name());
-                });
-                connect(dateTimeChartView, SIGNAL(showCoordinates(qreal, qreal, QString)), this,
-                        SLOT(showStatus(qreal, qreal, QString)));
-                connect(dateTimeChartView, SIGNAL(clearCoordinates()), statusBar(), SLOT(clearMessage()));
-                connect(relSeries, &QLineSeries::hovered, [=](const QPointF point, bool hovered) {
-                    relTimeChartView->setHovered(point, hovered, relSeries->name());
-                });
-                connect(relTimeChartView, SIGNAL(showCoordinates(qreal, qreal, QString)), this,
-                        SLOT(showStatus(qreal, qreal, QString)));
-                connect(relTimeChartView, SIGNAL(clearCoordinates()), statusBar(), SLOT(clearMessage()));
-
-                // Set dateSeries ID
-                QString name = fieldDataArray.first()[0].toString();
-                QString field = fieldDataArray.first()[1].toString().section(':', -1);
-                if (!chartFields.contains(field))
-                    chartFields.append(field);
-                dateSeries->setName(name);
-                relSeries->setName(name);
-                fieldDataArray.removeFirst();
-
-                if (fieldDataArray.first()[1].isString())
-                {
-                    foreach (const auto &dataPair, fieldDataArray)
-                    {
-                        auto dataPairArray = dataPair.toArray();
-                        dateSeries->append(startTime.addSecs(dataPairArray[0].toDouble()).toMSecsSinceEpoch(),
-                                           categoryValues.indexOf(dataPairArray[1].toString()));
-                        relSeries->append(dataPairArray[0].toDouble(), categoryValues.indexOf(dataPairArray[1].toString()));
-                    }
-                }
-                else
-                {
-                    foreach (const auto &dataPair, fieldDataArray)
+                QXYSeries *original = nullptr;
+                QXYSeries *live = nullptr;
+                for (auto *series : chartView->chart()->series())
+                    if (series->property("field").toString() == field)
                     {
-                        auto dataPairArray = dataPair.toArray();
-                        dateSeries->append(startTime.addSecs(dataPairArray[0].toDouble()).toMSecsSinceEpoch(),
-                                           dataPairArray[1].toDouble());
-                        relSeries->append(dataPairArray[0].toDouble(), dataPairArray[1].toDouble());
-                        if (dateTimeYAxis->min() == 0 && dateTimeYAxis->max() == 0)
-                            dateTimeYAxis->setRange(dataPairArray[1].toDouble(), dataPairArray[1].toDouble());
-                        if (dataPairArray[1].toDouble() < dateTimeYAxis->min())
-                            dateTimeYAxis->setMin(dataPairArray[1].toDouble());
-                        if (dataPairArray[1].toDouble() > dateTimeYAxis->max())
-                            dateTimeYAxis->setMax(dataPairArray[1].toDouble());
+                        if (series->name() == run)
+                            original = qobject_cast<QXYSeries *>(series);
+                        else if (series->name() == run + " (live)")
+                            live = qobject_cast<QXYSeries *>(series);
                     }
-                }
-                if (startTime.addSecs(startTime.secsTo(QDateTime::fromMSecsSinceEpoch(dateSeries->at(0).x()))) <
-                    timeAxis->min())
-                    timeAxis->setMin(
-                        startTime.addSecs(startTime.secsTo(QDateTime::fromMSecsSinceEpoch(dateSeries->at(0).x()))));
-                if (endTime > timeAxis->max())
-                    timeAxis->setMax(endTime);
-
-                if (relSeries->at(0).x() < relTimeXAxis->min())
-                    relTimeXAxis->setMin(relSeries->at(0).x());
-                if (relSeries->at(relSeries->count() - 1).x() > relTimeXAxis->max())
-                    relTimeXAxis->setMax(relSeries->at(relSeries->count() - 1).x());
-
-                dateTimeChart->addSeries(dateSeries);
-                dateSeries->attachAxis(timeAxis);
-                relTimeChart->addSeries(relSeries);
-                relSeries->attachAxis(relTimeXAxis);
-                if (categoryValues.isEmpty())
-                {
-                    dateSeries->attachAxis(dateTimeYAxis);
-                    relSeries->attachAxis(relTimeYAxis);
-                }
+                if (live)
+                    chartView->replaceSeriesData(live, data);
                 else
                 {
-                    dateSeries->attachAxis(dateTimeStringAxis);
-                    relSeries->attachAxis(relTimeStringAxis);
+                    // Drawn in the run's colour, under its legend entry
+                    auto logSeries = logData.series.first();
+                    logSeries.run = run + " (live)";
+                    logSeries.field = field;
+                    logSeries.data = data;
+                    chartView->addLogSeries({logSeries});
+                    for (auto *series : chartView->chart()->series())
+                        if (series->name() == logSeries.run && series->property("field").toString() == field)
+                            live = qobject_cast<QXYSeries *>(series);
+                    if (!live)
+                        continue;
+                    live->setProperty("live", true);
+                    if (original)
+                        live->setColor(original->color());
+                    for (auto *marker : chartView->chart()->legend()->markers(live))
+                        marker->setVisible(false);
                 }
+                chartView->follow(live, liveTail->previousLast(field));
             }
         }
+    });
+    worker->execute(input);
+}
 
-        if (!categoryValues.isEmpty())
-        {
-            dateTimeStringAxis->setRange(0, categoryValues.count() - 1);
-            relTimeStringAxis->setRange(0, categoryValues.count() - 1);
-            for (auto i = 0; i < categoryValues.count(); i++)
-            {
-                dateTimeStringAxis->append(categoryValues[i], i);
-                relTimeStringAxis->append(categoryValues[i], i);
-            }
-            dateTimeStringAxis->setLabelsPosition(QCategoryAxis::AxisLabelsPositionOnValue);
-            relTimeStringAxis->setLabelsPosition(QCategoryAxis::AxisLabelsPositionOnValue);
-        }
+// Add a channel computed from a log window's fields, for every run that has them
+void MainWindow::addDerivedChannel(QWidget *window)
+{
+    auto ok = false;
+    auto text = QInputDialog::getText(this, "Add derived channel",
+                                      "Expression of fields on the plot, e.g.\n"
+                                      "T_sample - T_setpoint\nmoving_avg(pressure, 60s)\nderivative(\"Field name\")\n"
+                                      "(functions: abs, sqrt, exp, log, derivative, moving_avg; durations in s, min or h)",
+                                      QLineEdit::Normal, QString(), &ok);
+    if (!ok || text.trimmed().isEmpty())
+        return;
 
-        relTimeYAxis->setRange(dateTimeYAxis->min(), dateTimeYAxis->max());
+    auto *derivedChannels = window->findChild<DerivedChannels *>("derivedChannels");
+    QString error;
+    if (!derivedChannels->addExpression(text, error))
+    {
+        QMessageBox::information(this, "", "Error2: " + error);
+        return;
+    }
+    updateDerivedChannels(window);
+}
 
-        auto *gridLayout = new QGridLayout(window);
-        auto *axisToggleCheck = new QCheckBox("Plot relative to run start times", window);
-        auto *addFieldButton = new QPushButton("Add field", window);
+void MainWindow::updateDerivedChannels(QWidget *window)
+{
+    auto *derivedChannels = window->findChild<DerivedChannels *>("derivedChannels");
+    auto derived = derivedChannels->update();
+    if (!derived.isEmpty())
+        for (auto *chartView : window->findChildren<ChartView *>())
+            chartView->addLogSeries(derived);
+    // Tiles hold min/max pairs rather than samples, so expressions reading tiled fields wait for their whole logs
+    for (const auto &needed : derivedChannels->samplesNeeded())
+        fetchLogSamples(window, needed.first, needed.second);
+}
 
-        addFieldButton->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
-        connect(axisToggleCheck, SIGNAL(stateChanged(int)), this, SLOT(toggleAxis(int)));
-        connect(addFieldButton, &QPushButton::clicked,
-                [=]() { fieldsMenu->exec(addFieldButton->mapToGlobal(QPoint(0, addFieldButton->height()))); });
+void MainWindow::removeTab(int index)
+{
+    auto *tab = ui_->tabWidget->widget(index);
+    tabHistory_.removeAll(tab);
+    delete tab;
+}
 
-        gridLayout->addWidget(dateTimeChartView, 1, 0, -1, -1);
-        gridLayout->addWidget(relTimeChartView, 1, 0, -1, -1);
-        relTimeChartView->hide();
-        gridLayout->addWidget(axisToggleCheck, 0, 0);
-        gridLayout->addWidget(addFieldButton, 0, 1);
-        QString tabName;
-        for (auto i = 0; i < chartFields.size(); i++)
-        {
-            tabName += chartFields[i];
-            if (i < chartFields.size() - 1)
-                tabName += ",";
-        }
-        if (!categoryValues.isEmpty())
-        {
-            dateTimeStringAxis->setTitleText(tabName);
-            relTimeStringAxis->setTitleText(tabName);
-        }
-        else
-        {
-            dateTimeYAxis->setTitleText(tabName);
-            relTimeYAxis->setTitleText(tabName);
-        }
-        ui_->tabWidget->addTab(window, tabName);
-        QString runs;
-        for (auto series : dateTimeChart->series())
-            runs.append(series->name() + ", ");
-        runs.chop(2);
-        QString toolTip = instDisplayName_ + "\n" + tabName + "\n" + runs;
-        ui_->tabWidget->setTabToolTip(ui_->tabWidget->count() - 1, toolTip);
-        ui_->tabWidget->setCurrentIndex(ui_->tabWidget->count() - 1);
-        dateTimeChartView->setFocus();
-    }
+// Wake a plot as it is shown
+void MainWindow::tabActivated(int index)
+{
+    auto *tab = ui_->tabWidget->widget(index);
+    if (index < 1 || !tab)
+        return;
+    setTabHibernated(tab, false);
+    tabHistory_.removeAll(tab);
+    tabHistory_.prepend(tab);
+    enforceMemoryBudget();
+}
+
+// Chart views of a plain chart tab or of a log window
+QList<ChartView *> MainWindow::tabChartViews(QWidget *tab)
+{
+    auto chartViews = tab->findChildren<ChartView *>();
+    if (auto *chartView = qobject_cast<ChartView *>(tab))
+        chartViews.append(chartView);
+    return chartViews;
+}
+
+qint64 MainWindow::tabMemory(QWidget *tab)
+{
+    // Log views share buffers, so each is counted once
+    QSet<const void *> counted;
+    if (auto *graph = qobject_cast<GraphWidget *>(tab))
+        return graph->memoryUsage(counted);
+    if (auto *heatmap = qobject_cast<HeatmapWidget *>(tab))
+        return heatmap->memoryUsage();
+    qint64 bytes = 0;
+    for (auto *chartView : tabChartViews(tab))
+        bytes += chartView->memoryUsage(counted);
+    // Log windows also hold series for deriving channels and refining tiles, and the samples of a live run
+    if (auto *derivedChannels = tab->findChild<DerivedChannels *>("derivedChannels"))
+        bytes += derivedChannels->memoryUsage(counted);
+    if (auto *logTiles = tab->findChild<LogTiles *>("logTiles"))
+        bytes += logTiles->memoryUsage(counted);
+    if (auto *liveTail = tab->findChild<LiveTail *>("liveTail"))
+        bytes += liveTail->memoryUsage();
+    return bytes;
+}
+
+bool MainWindow::isTabHibernated(QWidget *tab)
+{
+    if (auto *graph = qobject_cast<GraphWidget *>(tab))
+        return graph->isHibernating();
+    if (auto *heatmap = qobject_cast<HeatmapWidget *>(tab))
+        return heatmap->isHibernating();
+    auto chartViews = tabChartViews(tab);
+    return std::any_of(chartViews.cbegin(), chartViews.cend(),
+                       [](const ChartView *chartView) { return chartView->isHibernating(); });
+}
+
+// Log windows whose series are still held to derive channels or refine tiles would only gain a copy by hibernating
+bool MainWindow::canHibernateTab(QWidget *tab)
+{
+    auto *derivedChannels = tab->findChild<DerivedChannels *>("derivedChannels");
+    auto *logTiles = tab->findChild<LogTiles *>("logTiles");
+    return !(derivedChannels && derivedChannels->holdsSeries()) && !(logTiles && logTiles->holdsSeries());
+}
+
+void MainWindow::setTabHibernated(QWidget *tab, bool hibernated)
+{
+    if (auto *graph = qobject_cast<GraphWidget *>(tab))
+        hibernated ? graph->hibernate() : graph->wake();
+    else if (auto *heatmap = qobject_cast<HeatmapWidget *>(tab))
+        hibernated ? heatmap->hibernate() : heatmap->wake();
     else
     {
-        // an error occurred
-        msg = "Error2: " + worker->errorString;
-        QMessageBox::information(this, "", msg);
+        // The views of a log window share their buffers, which are set aside once and shared again on waking
+        auto buffers = QSharedPointer<ChartView::HibernatedBuffers>::create();
+        for (auto *chartView : tabChartViews(tab))
+            hibernated ? chartView->hibernate(buffers) : chartView->wake();
+        buffers->indices.clear();
     }
 }
 
-void MainWindow::removeTab(int index) { delete ui_->tabWidget->widget(index); }
+// Hibernate the least recently shown plots until all plots fit the memory budget, and show each plot's memory in its
+// tab tooltip
+void MainWindow::enforceMemoryBudget()
+{
+    auto *current = ui_->tabWidget->currentWidget();
+    // Tabs never shown count as the oldest
+    QList<QWidget *> tabs;
+    for (auto i = 1; i < ui_->tabWidget->count(); ++i)
+        if (!tabHistory_.contains(ui_->tabWidget->widget(i)))
+            tabs.append(ui_->tabWidget->widget(i));
+    for (auto it = tabHistory_.crbegin(); it != tabHistory_.crend(); ++it)
+        tabs.append(*it);
+
+    QHash<QWidget *, qint64> memory;
+    qint64 total = 0;
+    for (auto *tab : tabs)
+    {
+        memory[tab] = tabMemory(tab);
+        total += memory[tab];
+    }
+    auto budget = qint64(plotMemoryBudget_) * 1024 * 1024;
+    for (auto *tab : tabs)
+    {
+        if (total <= budget)
+            break;
+        if (tab == current || isTabHibernated(tab) || !canHibernateTab(tab))
+            continue;
+        setTabHibernated(tab, true);
+        auto hibernatedMemory = tabMemory(tab);
+        total -= memory[tab] - hibernatedMemory;
+        memory[tab] = hibernatedMemory;
+    }
+
+    for (auto *tab : tabs)
+    {
+        auto index = ui_->tabWidget->indexOf(tab);
+        auto toolTip = ui_->tabWidget->tabToolTip(index).section("\nMemory: ", 0, 0);
+        toolTip += "\nMemory: " + QString::number(memory[tab] / (1024.0 * 1024.0), 'f', 1) + " MB";
+        if (isTabHibernated(tab))
+            toolTip += " (hibernated)";
+        ui_->tabWidget->setTabToolTip(index, toolTip);
+    }
+}
 
 void MainWindow::toggleAxis(int state)
 {
@@ -471,7 +863,6 @@ void MainWindow::getField()
 {
     auto *action = qobject_cast<QAction *>(sender());
     auto *graphParent = ui_->tabWidget->currentWidget();
-    auto tabCharts = graphParent->findChildren<QChartView *>();
 
     auto runNos = getRunNos().split("-")[0];
     auto cycles = getRunNos().split("-")[1];
@@ -482,17 +873,173 @@ void MainWindow::getField()
         cycles.chop(1);
     }
 
-    QString url_str = "http://127.0.0.1:5000/getNexusData/";
-    QString cycle = cycles.split(";")[0];
-
     QString field = action->data().toString().replace("/", ":");
-    url_str += instName_ + "/" + cycle + "/" + runNos + "/" + action->data().toString().replace("/", ":");
+    auto fields = graphParent->property("fields").toStringList();
+    fields.append(field);
+    graphParent->setProperty("fields", fields);
+    QPointer<QWidget> window = graphParent;
+    fetchRunBlocks("getNexusData", cycles, runNos.split(";"), field, [=](QJsonArray, QJsonArray runs) {
+        if (!window)
+            return;
+        // Parse once for both views, off the GUI thread
+        auto *watcher = new QFutureWatcher<LogData>(window);
+        connect(watcher, &QFutureWatcher<LogData>::finished, [=]() {
+            addLogData(window, QJsonArray(), watcher->result());
+            watcher->deleteLater();
+        });
+        watcher->setFuture(QtConcurrent::run(&LogData::fromJson, runs));
+    });
+}
 
-    HttpRequestInput input(url_str);
-    auto *worker = new HttpRequestWorker(this);
-    connect(worker, SIGNAL(on_execution_finished(HttpRequestWorker *)), tabCharts[0], SLOT(addSeries(HttpRequestWorker *)));
-    connect(worker, SIGNAL(on_execution_finished(HttpRequestWorker *)), tabCharts[1], SLOT(addSeries(HttpRequestWorker *)));
-    worker->execute(input);
+// Plot the log window's field against another as a scatter, one series per run. Both are read at every time either
+// was recorded, optionally delaying the other field, and joined on worker threads
+void MainWindow::correlateField()
+{
+    struct Correlation
+    {
+        QStringList runs;
+        QVector<QSharedPointer<SeriesBuffer>> data;
+        qint64 points = 0;
+        qint64 elapsed = 0;
+    };
+
+    auto *action = qobject_cast<QAction *>(sender());
+    auto *graphParent = ui_->tabWidget->currentWidget();
+    auto field = graphParent->property("field").toString();
+    auto against = action->data().toString().replace("/", ":");
+    if (field.isEmpty())
+        return;
+    auto fieldName = field.section(':', -1);
+    auto againstName = against.section(':', -1);
+
+    auto runNos = getRunNos().split("-")[0];
+    auto cycles = getRunNos().split("-")[1];
+    if (runNos.size() == 0)
+        return;
+    if (cycles == "")
+    {
+        for (auto run : runNos.split(";"))
+            cycles.append(" ;");
+        cycles.chop(1);
+    }
+
+    QDialog dialog(this);
+    QFormLayout form(&dialog);
+    form.addRow(new QLabel("Plot " + fieldName + " against " + againstName));
+    auto *lag = new QDoubleSpinBox(&dialog);
+    lag->setRange(-86400, 86400);
+    lag->setDecimals(1);
+    lag->setSuffix(" s");
+    form.addRow("Delay " + againstName + " by:", lag);
+    auto *method = new QComboBox(&dialog);
+    method->addItems({"Interpolate", "Hold last value"});
+    form.addRow("Between samples:", method);
+
+    QDialogButtonBox buttonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, &dialog);
+    form.addRow(&buttonBox);
+    QObject::connect(&buttonBox, SIGNAL(accepted()), &dialog, SLOT(accept()));
+    QObject::connect(&buttonBox, SIGNAL(rejected()), &dialog, SLOT(reject()));
+    if (dialog.exec() != QDialog::Accepted)
+        return;
+    auto delay = lag->value();
+    auto joinMethod = method->currentIndex() == 0 ? LogJoin::Interpolate : LogJoin::HoldLast;
+
+    fetchRunBlocks("getNexusData", cycles, runNos.split(";"), field + ";" + against, [=](QJsonArray, QJsonArray runs) {
+        auto *watcher = new QFutureWatcher<Correlation>(this);
+        connect(watcher, &QFutureWatcher<Correlation>::finished, [=]() {
+            auto correlation = watcher->result();
+            watcher->deleteLater();
+            if (correlation.points == 0)
+            {
+                QMessageBox::information(this, "", "Error2: no times in common for " + fieldName + " and " + againstName);
+                return;
+            }
+
+            auto *chart = new QChart();
+            auto *chartView = new ChartView(chart, this);
+            auto *xAxis = new QValueAxis();
+            xAxis->setTitleText(delay == 0.0 ? againstName
+                                             : againstName + " (delayed " + QString::number(delay) + " s)");
+            chart->addAxis(xAxis, Qt::AlignBottom);
+            auto *yAxis = new QValueAxis();
+            yAxis->setTitleText(fieldName);
+            chart->addAxis(yAxis, Qt::AlignLeft);
+            auto minX = std::numeric_limits<double>::max();
+            auto maxX = std::numeric_limits<double>::lowest();
+            auto minY = minX;
+            auto maxY = maxX;
+            for (auto i = 0; i < correlation.runs.size(); ++i)
+            {
+                const auto &data = correlation.data[i];
+                if (data->size() == 0)
+                    continue;
+                auto *series = new QScatterSeries();
+                series->setName(correlation.runs[i]);
+                series->setMarkerSize(4);
+                chart->addSeries(series);
+                series->attachAxis(xAxis);
+                series->attachAxis(yAxis);
+                chartView->setSeriesData(series, data);
+                minX = std::min(minX, data->x(0));
+                maxX = std::max(maxX, data->x(data->size() - 1));
+                minY = std::min(minY, data->minY());
+                maxY = std::max(maxY, data->maxY());
+            }
+            xAxis->setRange(minX, maxX);
+            yAxis->setRange(minY, maxY);
+            connect(chartView, SIGNAL(showCoordinates(qreal, qreal, QString)), this, SLOT(showStatus(qreal, qreal, QString)));
+            connect(chartView, SIGNAL(clearCoordinates()), statusBar(), SLOT(clearMessage()));
+
+            auto title = fieldName + " vs " + againstName;
+            auto summary = QString::number(correlation.points) + " points joined in " +
+                           QString::number(correlation.elapsed) + " ms";
+            ui_->tabWidget->addTab(chartView, title);
+            ui_->tabWidget->setTabToolTip(ui_->tabWidget->count() - 1, instDisplayName_ + "\n" + title + "\n" +
+                                                                           correlation.runs.join(", ") + "\n" + summary);
+            ui_->tabWidget->setCurrentIndex(ui_->tabWidget->count() - 1);
+            statusBar()->showMessage(summary);
+        });
+        watcher->setFuture(QtConcurrent::run([=]() {
+            Correlation correlation;
+            QElapsedTimer timer;
+            timer.start();
+            // Each run's fields are parsed in request order, so its two series are adjacent
+            auto logData = LogData::fromJson(runs);
+            QVector<QPair<LogSeries, LogSeries>> pairs;
+            for (auto i = 0; i + 1 < logData.series.size(); ++i)
+                if (logData.series[i].run == logData.series[i + 1].run)
+                {
+                    pairs.append({logData.series[i], logData.series[i + 1]});
+                    ++i;
+                }
+
+            // Join runs in parallel, then order each by the horizontal value so views can find what is in range
+            auto joinRun = [=](const QPair<LogSeries, LogSeries> &pair) {
+                auto columns = LogJoin(joinMethod).join({pair.first.data.data(), pair.second.data.data()}, {0.0, delay});
+                QVector<QPointF> points(columns[0].size());
+                for (auto i = 0; i < points.size(); ++i)
+                    points[i] = QPointF(columns[1][i], columns[0][i]);
+                std::sort(points.begin(), points.end(),
+                          [](const QPointF &a, const QPointF &b) { return a.x() < b.x(); });
+                QVector<double> x(points.size());
+                QVector<double> y(points.size());
+                for (auto i = 0; i < points.size(); ++i)
+                {
+                    x[i] = points[i].x();
+                    y[i] = points[i].y();
+                }
+                return QSharedPointer<SeriesBuffer>::create(x, y);
+            };
+            correlation.data = QtConcurrent::blockingMapped<QVector<QSharedPointer<SeriesBuffer>>>(pairs, joinRun);
+            for (auto i = 0; i < pairs.size(); ++i)
+            {
+                correlation.runs.append(pairs[i].first.run);
+                correlation.points += correlation.data[i]->size();
+            }
+            correlation.elapsed = timer.elapsed();
+            return correlation;
+        }));
+    });
 }
 
 void MainWindow::showStatus(qreal x, qreal y, QString title)
@@ -512,62 +1059,105 @@ void MainWindow::showStatus(qreal x, qreal y, QString title)
     statusBar()->showMessage("Run " + title + ": " + message);
 }
 
-void MainWindow::handleSpectraCharting(HttpRequestWorker *worker)
+// Get per-run data blocks from a backend source, requesting only those not already cached. The handler receives the
+// response header (if known) and one block per run, in order
+void MainWindow::fetchRunBlocks(QString source, QString cycles, QStringList runs, QString item,
+                                std::function<void(QJsonArray, QJsonArray)> handler, std::function<void()> failed)
 {
-    auto *chart = new QChart();
-    auto *window = new GraphWidget(this, chart, "Detector");
-    connect(window, SIGNAL(muAmps(QString, bool, QString)), this, SLOT(muAmps(QString, bool, QString)));
-    connect(window, SIGNAL(runDivide(QString, QString, bool)), this, SLOT(runDivide(QString, QString, bool)));
-    connect(window, SIGNAL(monDivide(QString, QString, bool)), this, SLOT(monDivide(QString, QString, bool)));
-    ChartView *chartView = window->getChartView();
-
-    QString msg;
-    if (worker->errorType == QNetworkReply::NoError)
+    // Sources take either one cycle per run or a single cycle for all
+    auto cycleList = cycles.split(";");
+    QStringList keys;
+    QVector<QJsonArray> blocks(runs.size());
+    QStringList missingRuns;
+    QStringList missingCycles;
+    QVector<int> missing;
+    for (auto i = 0; i < runs.size(); ++i)
     {
-        auto workerArray = worker->jsonArray;
-        QString field = "Detector ";
-        auto metaData = workerArray[0].toArray();
-        QString runs = metaData[0].toString();
-        window->setChartRuns(metaData[0].toString());
-        window->setChartDetector(metaData[1].toString());
-        field += metaData[1].toString();
-        workerArray.removeFirst();
-        window->setChartData(workerArray);
-
-        foreach (const auto &run, workerArray)
+        auto cycle = cycleList.value(i, cycleList.first());
+        keys.append(DataCache::key(source, instName_, cycle, runs[i], item));
+        // The header is held with the first run's block, but may be evicted apart from it
+        if (dataCache_.contains(keys[i]) && (i > 0 || dataCache_.contains(keys[i] + ":header")))
+            blocks[i] = dataCache_.value(keys[i]);
+        else
         {
-            auto runArray = run.toArray();
-            // For each plot point
-            auto *series = new QLineSeries();
+            missing.append(i);
+            missingRuns.append(runs[i]);
+            missingCycles.append(cycle);
+        }
+    }
 
-            connect(series, &QLineSeries::hovered,
-                    [=](const QPointF point, bool hovered) { chartView->setHovered(point, hovered, series->name()); });
-            connect(chartView, SIGNAL(showCoordinates(qreal, qreal, QString)), this, SLOT(showStatus(qreal, qreal, QString)));
-            connect(chartView, SIGNAL(clearCoordinates()), statusBar(), SLOT(clearMessage()));
+    auto headerKey = keys.isEmpty() ? QString() : keys.first() + ":header";
+    if (missing.isEmpty())
+    {
+        QJsonArray blockArray;
+        for (const auto &block : blocks)
+            blockArray.append(block);
+        handler(dataCache_.value(headerKey), blockArray);
+        return;
+    }
 
-            for (auto i = 0; i < runArray.count() - 1; i++)
-            {
-                auto centreBin =
-                    runArray.at(i)[0].toDouble() + (runArray.at(i + 1)[0].toDouble() - runArray.at(i)[0].toDouble()) / 2;
-                series->append(centreBin, runArray.at(i)[1].toDouble());
-            }
-            chart->addSeries(series);
+    QString url_str = "http://127.0.0.1:5000/" + source + "/" + instName_ + "/";
+    url_str += (cycleList.size() > 1 ? missingCycles.join(";") : cycles) + "/" + missingRuns.join(";") + "/" + item;
+    HttpRequestInput input(url_str);
+    auto *worker = new HttpRequestWorker(this);
+    connect(worker, &HttpRequestWorker::on_execution_finished, [=](HttpRequestWorker *workerProxy) {
+        if (workerProxy->errorType != QNetworkReply::NoError || workerProxy->jsonArray.size() != missing.size() + 1)
+        {
+            if (failed)
+                failed();
+            else
+                QMessageBox::information(this, "", "Error2: " + workerProxy->errorString);
+            workerProxy->deleteLater();
+            return;
         }
-        for (auto i = 0; i < chart->series().count(); i++)
+        auto header = workerProxy->jsonArray[0].toArray();
+        if (missing.first() == 0)
+            dataCache_.insert(headerKey, header);
+
+        auto allBlocks = blocks;
+        for (auto j = 0; j < missing.size(); ++j)
         {
-            auto *series = chart->series()[i];
-            series->setName(runs.split(";")[i]);
+            allBlocks[missing[j]] = workerProxy->jsonArray[j + 1].toArray();
+            dataCache_.insert(keys[missing[j]], allBlocks[missing[j]]);
         }
-        chart->createDefaultAxes();
-        chart->axes(Qt::Horizontal)[0]->setTitleText("Time of flight, &#181;s");
-        chart->axes(Qt::Vertical)[0]->setTitleText("Counts");
-        QString tabName = field;
-        ui_->tabWidget->addTab(window, tabName);
-        ui_->tabWidget->setCurrentIndex(ui_->tabWidget->count() - 1);
-        QString toolTip = field + "\n" + runs;
-        ui_->tabWidget->setTabToolTip(ui_->tabWidget->count() - 1, toolTip);
-        chartView->setFocus();
+        QJsonArray blockArray;
+        for (const auto &block : allBlocks)
+            blockArray.append(block);
+        workerProxy->deleteLater();
+        handler(header, blockArray);
+    });
+    worker->execute(input);
+}
 
+// Plot detector or monitor spectra, one series per run
+GraphWidget *MainWindow::handleSpectraCharting(QString type, QString runs, QString spectrum, QJsonArray blocks)
+{
+    auto *chart = new QChart();
+    auto *window = new GraphWidget(this, chart, type);
+    connect(window, SIGNAL(muAmps(QString, bool, QString)), this, SLOT(muAmps(QString, bool, QString)));
+    connect(window, SIGNAL(runDivide(QString, QString, bool)), this, SLOT(runDivide(QString, QString, bool)));
+    connect(window, SIGNAL(monDivide(QString, QString, bool)), this, SLOT(monDivide(QString, QString, bool)));
+    connect(window, SIGNAL(flightPaths(QString, QString, QString)), this, SLOT(flightPaths(QString, QString, QString)));
+    ChartView *chartView = window->getChartView();
+    connect(chartView, SIGNAL(showCoordinates(qreal, qreal, QString)), this, SLOT(showStatus(qreal, qreal, QString)));
+    connect(chartView, SIGNAL(clearCoordinates()), statusBar(), SLOT(clearMessage()));
+
+    QString field = type + " " + spectrum;
+    window->setChartRuns(runs);
+    window->setChartDetector(spectrum);
+    window->setChartData(blocks);
+
+    chart->axes(Qt::Horizontal)[0]->setTitleText("Time of flight, &#181;s");
+    chart->axes(Qt::Vertical)[0]->setTitleText("Counts");
+    QString tabName = field;
+    ui_->tabWidget->addTab(window, tabName);
+    ui_->tabWidget->setCurrentIndex(ui_->tabWidget->count() - 1);
+    QString toolTip = field + "\n" + runs;
+    ui_->tabWidget->setTabToolTip(ui_->tabWidget->count() - 1, toolTip);
+    chartView->setFocus();
+
+    if (type == "Detector")
+    {
         QString cycle = cyclesMap_[ui_->cycleButton->text()];
         cycle.replace(0, 7, "cycle").replace(".xml", "");
 
@@ -579,76 +1169,7 @@ void MainWindow::handleSpectraCharting(HttpRequestWorker *worker)
                 [=](HttpRequestWorker *detectorCount) { window->setLabel(detectorCount->response); });
         worker->execute(input);
     }
-    else
-    {
-        // an error occurred
-        msg = "Error2: " + worker->errorString;
-        QMessageBox::information(this, "", msg);
-    }
-}
-
-void MainWindow::handleMonSpectraCharting(HttpRequestWorker *worker)
-{
-    auto *chart = new QChart();
-    auto *window = new GraphWidget(this, chart, "Monitor");
-    connect(window, SIGNAL(muAmps(QString, bool, QString)), this, SLOT(muAmps(QString, bool, QString)));
-    connect(window, SIGNAL(runDivide(QString, QString, bool)), this, SLOT(runDivide(QString, QString, bool)));
-    connect(window, SIGNAL(monDivide(QString, QString, bool)), this, SLOT(monDivide(QString, QString, bool)));
-    ChartView *chartView = window->getChartView();
-
-    QString msg;
-    if (worker->errorType == QNetworkReply::NoError)
-    {
-        auto workerArray = worker->jsonArray;
-        QString field = "Monitor ";
-        auto metaData = workerArray[0].toArray();
-        QString runs = metaData[0].toString();
-        window->setChartRuns(metaData[0].toString());
-        window->setChartDetector(metaData[1].toString());
-        field += metaData[1].toString();
-        workerArray.removeFirst();
-        window->setChartData(workerArray);
-
-        foreach (const auto &run, workerArray)
-        {
-            auto runArray = run.toArray();
-            // For each plot point
-            auto *series = new QLineSeries();
-
-            connect(series, &QLineSeries::hovered,
-                    [=](const QPointF point, bool hovered) { chartView->setHovered(point, hovered, series->name()); });
-            connect(chartView, SIGNAL(showCoordinates(qreal, qreal, QString)), this, SLOT(showStatus(qreal, qreal, QString)));
-            connect(chartView, SIGNAL(clearCoordinates()), statusBar(), SLOT(clearMessage()));
-
-            for (auto i = 0; i < runArray.count() - 1; i++)
-            {
-                auto centreBin =
-                    runArray.at(i)[0].toDouble() + (runArray.at(i + 1)[0].toDouble() - runArray.at(i)[0].toDouble()) / 2;
-                series->append(centreBin, runArray.at(i)[1].toDouble());
-            }
-            chart->addSeries(series);
-        }
-        for (auto i = 0; i < chart->series().count(); i++)
-        {
-            auto *series = chart->series()[i];
-            series->setName(runs.split(";")[i]);
-        }
-        chart->createDefaultAxes();
-        chart->axes(Qt::Horizontal)[0]->setTitleText("Time of flight, &#181;s");
-        chart->axes(Qt::Vertical)[0]->setTitleText("Counts");
-        QString tabName = field;
-        ui_->tabWidget->addTab(window, tabName);
-        ui_->tabWidget->setCurrentIndex(ui_->tabWidget->count() - 1);
-        QString toolTip = field + "\n" + runs;
-        ui_->tabWidget->setTabToolTip(ui_->tabWidget->count() - 1, toolTip);
-        chartView->setFocus();
-    }
-    else
-    {
-        // an error occurred
-        msg = "Error2: " + worker->errorString;
-        QMessageBox::information(this, "", msg);
-    }
+    return window;
 }
 
 void MainWindow::getSpectrumCount()
@@ -689,33 +1210,490 @@ void MainWindow::getMonitorCount()
     worker->execute(input);
 }
 
+// Open a detector spectra browser on the first spectrum
 void MainWindow::plotSpectra(HttpRequestWorker *count)
 {
     setLoadScreen(false);
-    auto spectraCount = count->response.toUtf8();
-    spectraCount.chop(1);
-    bool valid;
-    auto spectrumNumber = QInputDialog::getInt(this, tr("Plot Detector Spectrum"),
-                                               tr("Enter detector spectrum to plot (0-" + spectraCount + "):"), 0, 0,
-                                               count->response.toInt() - 1, 1, &valid);
-    if (!valid)
+    auto spectraCount = count->response.toInt();
+    auto runNos = getRunNos().split("-")[0];
+    // Error handling
+    if (runNos.size() == 0 || spectraCount < 1)
+        return;
+
+    QString cycle = cyclesMap_[ui_->cycleButton->text()];
+    cycle.replace(0, 7, "cycle").replace(".xml", "");
+
+    openSpectrumBrowser(cycle, runNos, 0, spectraCount);
+}
+
+void MainWindow::openSpectrumBrowser(QString cycle, QString runs, int spectrum, int spectraCount)
+{
+    fetchSpectrum(cycle, runs, spectrum, spectraCount, [=](QJsonArray blocks) {
+        auto *window = handleSpectraCharting("Detector", runs, QString::number(spectrum), blocks);
+        window->setSpectrumCount(spectraCount);
+        connect(window, SIGNAL(spectrumRequested(QString, int)), this, SLOT(changeSpectrum(QString, int)));
+    });
+}
+
+// Show all detector counts of the first selected run
+void MainWindow::plotDetectorHeatmap()
+{
+    auto runNos = getRunNos().split("-")[0];
+    // Error handling
+    if (runNos.size() == 0)
         return;
+    auto run = runNos.split(";")[0];
+
+    QString cycle = cyclesMap_[ui_->cycleButton->text()];
+    cycle.replace(0, 7, "cycle").replace(".xml", "");
+
+    QString url_str = "http://127.0.0.1:5000/getDetectorCounts/" + instName_ + "/" + cycle + "/" + run;
+    HttpRequestInput input(url_str);
+    auto *worker = new HttpRequestWorker(this);
+    connect(worker, &HttpRequestWorker::on_execution_finished, [=](HttpRequestWorker *workerProxy) {
+        setLoadScreen(false);
+        workerProxy->deleteLater();
+        auto *heatmap = new HeatmapWidget();
+        if (workerProxy->errorType != QNetworkReply::NoError || !heatmap->setData(workerProxy->rawResponse))
+        {
+            delete heatmap;
+            QMessageBox::information(this, "", "Error2: " + (workerProxy->errorString.isEmpty()
+                                                                 ? QString("detector counts could not be read")
+                                                                 : workerProxy->errorString));
+            return;
+        }
+        connect(heatmap, &HeatmapWidget::statusChanged, [=](QString message) {
+            if (message.isEmpty())
+                statusBar()->clearMessage();
+            else
+                statusBar()->showMessage("Run " + run + ": " + message);
+        });
+        connect(heatmap, &HeatmapWidget::spectrumClicked,
+                [=](int spectrum) { openSpectrumBrowser(cycle, run, spectrum, heatmap->spectrumCount()); });
+
+        ui_->tabWidget->addTab(heatmap, "Detector counts " + run);
+        ui_->tabWidget->setTabToolTip(ui_->tabWidget->count() - 1, instDisplayName_ + "\nDetector counts\n" + run);
+        ui_->tabWidget->setCurrentIndex(ui_->tabWidget->count() - 1);
+    });
+    setLoadScreen(true);
+    worker->execute(input);
+}
+
+// Find peaks in every detector spectrum of the first selected run, and plot the strongest in each
+void MainWindow::findRunPeaks()
+{
+    struct RunPeaks
+    {
+        bool valid = false;
+        int spectra = 0;
+        int peaks = 0;
+        qint64 elapsed = 0;
+        QVector<double> spectrum;
+        QVector<double> position;
+    };
+
     auto runNos = getRunNos().split("-")[0];
     // Error handling
     if (runNos.size() == 0)
         return;
+    auto run = runNos.split(";")[0];
 
     QString cycle = cyclesMap_[ui_->cycleButton->text()];
     cycle.replace(0, 7, "cycle").replace(".xml", "");
 
-    QString url_str = "http://127.0.0.1:5000/getSpectrum/";
-    url_str += instName_ + "/" + cycle + "/" + runNos + "/" + QString::number(spectrumNumber);
+    QString url_str = "http://127.0.0.1:5000/getDetectorCounts/" + instName_ + "/" + cycle + "/" + run;
     HttpRequestInput input(url_str);
     auto *worker = new HttpRequestWorker(this);
-    connect(worker, SIGNAL(on_execution_finished(HttpRequestWorker *)), this, SLOT(handleSpectraCharting(HttpRequestWorker *)));
+    connect(worker, &HttpRequestWorker::on_execution_finished, [=](HttpRequestWorker *workerProxy) {
+        workerProxy->deleteLater();
+        if (workerProxy->errorType != QNetworkReply::NoError)
+        {
+            setLoadScreen(false);
+            QMessageBox::information(this, "", "Error2: " + workerProxy->errorString);
+            return;
+        }
+
+        // Spectra are searched in parallel off the GUI thread
+        auto data = workerProxy->rawResponse;
+        auto *watcher = new QFutureWatcher<RunPeaks>(this);
+        connect(watcher, &QFutureWatcher<RunPeaks>::finished, [=]() {
+            setLoadScreen(false);
+            auto runPeaks = watcher->result();
+            watcher->deleteLater();
+            if (!runPeaks.valid)
+            {
+                QMessageBox::information(this, "", "Error2: detector counts could not be read");
+                return;
+            }
+
+            auto *chart = new QChart();
+            auto *chartView = new ChartView(chart, this);
+            auto *series = new QScatterSeries();
+            series->setName(run);
+            series->setMarkerSize(4);
+            chart->addSeries(series);
+            chart->legend()->hide();
+            auto *xAxis = new QValueAxis();
+            xAxis->setTitleText("Spectrum");
+            xAxis->setRange(0, std::max(runPeaks.spectra - 1, 1));
+            chart->addAxis(xAxis, Qt::AlignBottom);
+            series->attachAxis(xAxis);
+            auto *yAxis = new QValueAxis();
+            yAxis->setTitleText("Strongest peak, time of flight, &#181;s");
+            if (!runPeaks.position.isEmpty())
+            {
+                auto range = std::minmax_element(runPeaks.position.cbegin(), runPeaks.position.cend());
+                yAxis->setRange(*range.first, *range.second);
+            }
+            chart->addAxis(yAxis, Qt::AlignLeft);
+            series->attachAxis(yAxis);
+            chartView->setSeriesData(series, QSharedPointer<SeriesBuffer>::create(runPeaks.spectrum, runPeaks.position));
+            connect(chartView, SIGNAL(showCoordinates(qreal, qreal, QString)), this, SLOT(showStatus(qreal, qreal, QString)));
+            connect(chartView, SIGNAL(clearCoordinates()), statusBar(), SLOT(clearMessage()));
+
+            auto summary = QString::number(runPeaks.peaks) + " peaks in " + QString::number(runPeaks.spectra) +
+                           " spectra, found in " + QString::number(runPeaks.elapsed) + " ms";
+            ui_->tabWidget->addTab(chartView, "Peaks " + run);
+            ui_->tabWidget->setTabToolTip(ui_->tabWidget->count() - 1,
+                                          instDisplayName_ + "\nDetector peaks\n" + run + "\n" + summary);
+            ui_->tabWidget->setCurrentIndex(ui_->tabWidget->count() - 1);
+            statusBar()->showMessage("Run " + run + ": " + summary);
+        });
+        watcher->setFuture(QtConcurrent::run([data]() {
+            RunPeaks runPeaks;
+            DetectorCounts counts;
+            if (!counts.fromBinary(data))
+                return runPeaks;
+            QElapsedTimer timer;
+            timer.start();
+            auto peaks = PeakFinder().findAll(counts.counts, counts.spectra, counts.bins);
+            runPeaks.valid = true;
+            runPeaks.spectra = counts.spectra;
+            const auto &timeOfFlight = counts.timeOfFlight;
+            for (auto spectrum = 0; spectrum < peaks.size(); ++spectrum)
+            {
+                const auto &spectrumPeaks = peaks[spectrum];
+                runPeaks.peaks += spectrumPeaks.size();
+                if (spectrumPeaks.isEmpty())
+                    continue;
+                auto strongest = std::max_element(
+                    spectrumPeaks.cbegin(), spectrumPeaks.cend(),
+                    [](const PeakFinder::Peak &a, const PeakFinder::Peak &b) { return a.height < b.height; });
+                // Fractional bin index to time of flight, from bin centres
+                auto bin = strongest->bin + 0.5;
+                auto lower = std::clamp((int)bin, 0, counts.bins - 1);
+                runPeaks.spectrum.append(spectrum);
+                runPeaks.position.append(timeOfFlight[lower] +
+                                         (bin - lower) * (timeOfFlight[lower + 1] - timeOfFlight[lower]));
+            }
+            runPeaks.elapsed = timer.elapsed();
+            return runPeaks;
+        }));
+    });
+    setLoadScreen(true);
     worker->execute(input);
 }
 
+// Choose a range of detector spectra to combine over the selected runs
+void MainWindow::aggregateSpectra()
+{
+    auto runNos = getRunNos().split("-")[0];
+    // Error handling
+    if (runNos.size() == 0)
+        return;
+
+    QString cycle = cyclesMap_[ui_->cycleButton->text()];
+    cycle.replace(0, 7, "cycle").replace(".xml", "");
+
+    QString url_str = "http://127.0.0.1:5000/getSpectrumRange/";
+    url_str += instName_ + "/" + cycle + "/" + runNos;
+    HttpRequestInput input(url_str);
+    auto *worker = new HttpRequestWorker(this);
+    connect(worker, &HttpRequestWorker::on_execution_finished, [=](HttpRequestWorker *workerProxy) {
+        setLoadScreen(false);
+        workerProxy->deleteLater();
+        auto spectraCount = workerProxy->response.toInt();
+        if (workerProxy->errorType != QNetworkReply::NoError || spectraCount < 1)
+        {
+            QMessageBox::information(this, "", "Error2: " + workerProxy->errorString);
+            return;
+        }
+
+        QDialog dialog(this);
+        QFormLayout form(&dialog);
+
+        form.addRow(new QLabel("Aggregate detector spectra (0-" + QString::number(spectraCount - 1) + ")"));
+        auto *first = new QSpinBox(&dialog);
+        first->setRange(0, spectraCount - 1);
+        form.addRow("First spectrum:", first);
+        auto *last = new QSpinBox(&dialog);
+        last->setRange(0, spectraCount - 1);
+        last->setValue(spectraCount - 1);
+        form.addRow("Last spectrum:", last);
+        auto *mode = new QComboBox(&dialog);
+        mode->addItems({"Sum", "Average"});
+        form.addRow("Combine:", mode);
+        auto *weighted = new QCheckBox(&dialog);
+        form.addRow("Normalise by proton charge", weighted);
+
+        QDialogButtonBox buttonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, &dialog);
+        form.addRow(&buttonBox);
+        QObject::connect(&buttonBox, SIGNAL(accepted()), &dialog, SLOT(accept()));
+        QObject::connect(&buttonBox, SIGNAL(rejected()), &dialog, SLOT(reject()));
+
+        if (dialog.exec() != QDialog::Accepted)
+            return;
+        auto range = std::minmax(first->value(), last->value());
+        plotAggregateSpectrum(cycle, runNos, range.first, range.second - range.first + 1, mode->currentIndex() == 1,
+                              weighted->isChecked());
+    });
+    setLoadScreen(true);
+    worker->execute(input);
+}
+
+// Fetch a range of detector spectra for each run, reducing each to a per bin sum on worker threads as it arrives,
+// then combine the runs into a single series. Weighted spectra are divided by the total proton charge of the runs
+void MainWindow::plotAggregateSpectrum(QString cycle, QString runs, int first, int count, bool average, bool weighted)
+{
+    struct Aggregate
+    {
+        QVector<QVector<double>> timeOfFlight;
+        QVector<QVector<double>> sums;
+        QVector<double> charges;
+        QStringList failed;
+        int remaining;
+    };
+
+    auto runList = runs.split(";");
+    QStringList urls;
+    for (const auto &run : runList)
+        urls.append("http://127.0.0.1:5000/getDetectorCounts/" + instName_ + "/" + cycle + "/" + run + "/" +
+                    QString::number(first) + "/" + QString::number(count));
+    if (weighted)
+        urls.append("http://127.0.0.1:5000/getTotalMuAmps/" + instName_ + "/" + cyclesMap_[ui_->cycleButton->text()] +
+                    "/" + runs);
+
+    auto aggregate = QSharedPointer<Aggregate>::create();
+    aggregate->timeOfFlight.resize(runList.size());
+    aggregate->sums.resize(runList.size());
+    aggregate->remaining = urls.size();
+    auto *queue = new RequestQueue(urls, MaxCountRequests, this);
+
+    auto finish = [=]() {
+        setLoadScreen(false);
+        queue->deleteLater();
+        if (!aggregate->failed.isEmpty())
+        {
+            QMessageBox::information(this, "", "Error2: detector counts could not be read for " +
+                                                   aggregate->failed.join(", "));
+            return;
+        }
+        const auto &timeOfFlight = aggregate->timeOfFlight.first();
+        auto bins = aggregate->sums.first().size();
+        for (const auto &binning : aggregate->timeOfFlight)
+            if (binning != timeOfFlight)
+            {
+                QMessageBox::information(this, "", "Error2: runs do not share time of flight binning");
+                return;
+            }
+
+        auto divisor = average ? double(count) : 1.0;
+        if (weighted)
+            divisor *= std::accumulate(aggregate->charges.cbegin(), aggregate->charges.cend(), 0.0);
+        else if (average)
+            divisor *= runList.size();
+        if (divisor <= 0.0)
+        {
+            QMessageBox::information(this, "", "Error2: no proton charge recorded for " + runs);
+            return;
+        }
+
+        QVector<double> binCentres(bins);
+        QVector<double> values(bins, 0.0);
+        for (const auto &sum : aggregate->sums)
+            for (auto bin = 0; bin < bins; ++bin)
+                values[bin] += sum[bin];
+        for (auto bin = 0; bin < bins; ++bin)
+        {
+            binCentres[bin] = (timeOfFlight[bin] + timeOfFlight[bin + 1]) / 2;
+            values[bin] /= divisor;
+        }
+
+        auto title = (average ? "Average" : "Sum") + QString(" of spectra ") + QString::number(first) + "-" +
+                     QString::number(first + count - 1);
+        auto *chart = new QChart();
+        auto *chartView = new ChartView(chart, this);
+        auto *series = new QLineSeries();
+        series->setName(runs);
+        chart->addSeries(series);
+        auto *xAxis = new QValueAxis();
+        xAxis->setTitleText("Time of flight, &#181;s");
+        xAxis->setRange(binCentres.first(), binCentres.last());
+        chart->addAxis(xAxis, Qt::AlignBottom);
+        series->attachAxis(xAxis);
+        auto *yAxis = new QValueAxis();
+        yAxis->setTitleText(weighted ? "Counts/&#181;Ah" : "Counts");
+        auto range = std::minmax_element(values.cbegin(), values.cend());
+        yAxis->setRange(*range.first, *range.second);
+        chart->addAxis(yAxis, Qt::AlignLeft);
+        series->attachAxis(yAxis);
+        chartView->setSeriesData(series, QSharedPointer<SeriesBuffer>::create(binCentres, values));
+        connect(chartView, SIGNAL(showCoordinates(qreal, qreal, QString)), this, SLOT(showStatus(qreal, qreal, QString)));
+        connect(chartView, SIGNAL(clearCoordinates()), statusBar(), SLOT(clearMessage()));
+
+        ui_->tabWidget->addTab(chartView, title);
+        ui_->tabWidget->setTabToolTip(ui_->tabWidget->count() - 1, instDisplayName_ + "\n" + title + "\n" + runs);
+        ui_->tabWidget->setCurrentIndex(ui_->tabWidget->count() - 1);
+    };
+
+    connect(queue, &RequestQueue::requestFinished, [=](int index, HttpRequestWorker *worker) {
+        if (worker->errorType != QNetworkReply::NoError)
+        {
+            aggregate->failed.append(index < runList.size() ? runList[index] : "proton charge");
+            if (--aggregate->remaining == 0)
+                finish();
+            return;
+        }
+
+        if (index == runList.size())
+        {
+            for (const auto &charge : worker->response.split(";"))
+                aggregate->charges.append(charge.toDouble());
+            if (aggregate->charges.size() != runList.size())
+                aggregate->failed.append("proton charge");
+            if (--aggregate->remaining == 0)
+                finish();
+            return;
+        }
+
+        // Decode and sum over the spectrum range off the GUI thread, keeping only the bin boundaries and sums
+        using RunSum = QPair<QVector<double>, QVector<double>>;
+        auto data = worker->rawResponse;
+        auto *watcher = new QFutureWatcher<RunSum>(this);
+        connect(watcher, &QFutureWatcher<RunSum>::finished, [=]() {
+            auto runSum = watcher->result();
+            watcher->deleteLater();
+            if (runSum.second.isEmpty())
+                aggregate->failed.append(runList[index]);
+            aggregate->timeOfFlight[index] = runSum.first;
+            aggregate->sums[index] = runSum.second;
+            if (--aggregate->remaining == 0)
+                finish();
+        });
+        watcher->setFuture(QtConcurrent::run([data]() {
+            DetectorCounts counts;
+            if (!counts.fromBinary(data))
+                return RunSum();
+            return RunSum(counts.timeOfFlight, counts.summed());
+        }));
+    });
+
+    setLoadScreen(true);
+    queue->start();
+}
+
+// Get a detector spectrum for each run. Spectra are fetched in blocks which are cached spectrum by spectrum, and the
+// blocks either side of the one requested are prefetched so stepping through them does not wait on the archive
+void MainWindow::fetchSpectrum(QString cycle, QString runs, int spectrum, int spectraCount,
+                               std::function<void(QJsonArray)> handler)
+{
+    auto runList = runs.split(";");
+    auto cachedSpectrum = [=](int index, QJsonArray &blocks) {
+        for (const auto &run : runList)
+        {
+            auto key = DataCache::key("getSpectrum", instName_, cycle, run, QString::number(index));
+            if (!dataCache_.contains(key))
+                return false;
+            blocks.append(dataCache_.value(key));
+        }
+        return true;
+    };
+
+    auto first = spectrum / SpectrumBlockSize * SpectrumBlockSize;
+    for (auto neighbour : {first - SpectrumBlockSize, first + SpectrumBlockSize})
+    {
+        QJsonArray unused;
+        if (handler && neighbour >= 0 && neighbour < spectraCount && !cachedSpectrum(neighbour, unused))
+            fetchSpectrum(cycle, runs, neighbour, spectraCount, nullptr);
+    }
+
+    QJsonArray blocks;
+    if (cachedSpectrum(spectrum, blocks))
+    {
+        if (handler)
+            handler(blocks);
+        return;
+    }
+
+    // Join a request already in flight for the same block
+    auto blockKey = DataCache::key("getSpectrumBlock", instName_, cycle, runs, QString::number(first));
+    auto pending = pendingSpectrumBlocks_.contains(blockKey);
+    auto &handlers = pendingSpectrumBlocks_[blockKey];
+    if (handler)
+        handlers.append([=](QVector<QJsonArray> spectra) { handler(spectra.value(spectrum - first)); });
+    if (pending)
+        return;
+
+    QString url_str = "http://127.0.0.1:5000/getSpectrumBlock/" + instName_ + "/" + cycle + "/" + runs + "/" +
+                      QString::number(first) + "/" + QString::number(SpectrumBlockSize);
+    HttpRequestInput input(url_str);
+    auto *worker = new HttpRequestWorker(this);
+    connect(worker, &HttpRequestWorker::on_execution_finished, [=](HttpRequestWorker *workerProxy) {
+        auto blockHandlers = pendingSpectrumBlocks_.take(blockKey);
+        workerProxy->deleteLater();
+        if (workerProxy->errorType != QNetworkReply::NoError || workerProxy->jsonArray.size() != runList.size() + 1)
+        {
+            if (!blockHandlers.isEmpty())
+                QMessageBox::information(this, "", "Error2: " + workerProxy->errorString);
+            return;
+        }
+
+        // Split each run's block into (time of flight, counts) spectra, as returned by getSpectrum
+        QVector<QJsonArray> spectra;
+        for (auto r = 0; r < runList.size(); ++r)
+        {
+            auto runBlock = workerProxy->jsonArray[r + 1].toArray();
+            auto timeOfFlight = runBlock[0].toArray();
+            auto counts = runBlock[1].toArray();
+            spectra.resize(std::max(spectra.size(), counts.size()));
+            for (auto k = 0; k < counts.size(); ++k)
+            {
+                auto spectrumCounts = counts[k].toArray();
+                QJsonArray points;
+                for (auto j = 0; j < std::min(timeOfFlight.size(), spectrumCounts.size()); ++j)
+                    points.append(QJsonArray({timeOfFlight[j], spectrumCounts[j]}));
+                dataCache_.insert(DataCache::key("getSpectrum", instName_, cycle, runList[r], QString::number(first + k)),
+                                  points);
+                spectra[k].append(points);
+            }
+        }
+        for (const auto &blockHandler : blockHandlers)
+            blockHandler(spectra);
+    });
+    worker->execute(input);
+}
+
+// Redraw a browser on a different spectrum
+void MainWindow::changeSpectrum(QString runs, int spectrum)
+{
+    auto *window = qobject_cast<GraphWidget *>(sender());
+    QString cycle = cyclesMap_[ui_->cycleButton->text()];
+    cycle.replace(0, 7, "cycle").replace(".xml", "");
+
+    QPointer<GraphWidget> target = window;
+    fetchSpectrum(cycle, runs, spectrum, window->getSpectrumCount(), [=](QJsonArray blocks) {
+        if (!target)
+            return;
+        target->showSpectrum(spectrum, blocks);
+        auto index = ui_->tabWidget->indexOf(target);
+        if (index != -1 && target->getChartDetector() == QString::number(spectrum))
+        {
+            ui_->tabWidget->setTabText(index, "Detector " + QString::number(spectrum));
+            ui_->tabWidget->setTabToolTip(index, "Detector " + QString::number(spectrum) + "\n" + runs);
+        }
+    });
+}
+
 void MainWindow::plotMonSpectra(HttpRequestWorker *count)
 {
     setLoadScreen(false);
@@ -735,13 +1713,9 @@ void MainWindow::plotMonSpectra(HttpRequestWorker *count)
     QString cycle = cyclesMap_[ui_->cycleButton->text()];
     cycle.replace(0, 7, "cycle").replace(".xml", "");
 
-    QString url_str = "http://127.0.0.1:5000/getMonSpectrum/";
-    url_str += instName_ + "/" + cycle + "/" + runNos + "/" + QString::number(monNumber);
-    HttpRequestInput input(url_str);
-    auto *worker = new HttpRequestWorker(this);
-    connect(worker, SIGNAL(on_execution_finished(HttpRequestWorker *)), this,
-            SLOT(handleMonSpectraCharting(HttpRequestWorker *)));
-    worker->execute(input);
+    auto monitor = QString::number(monNumber);
+    fetchRunBlocks("getMonSpectrum", cycle, runNos.split(";"), monitor,
+                   [=](QJsonArray, QJsonArray blocks) { handleSpectraCharting("Monitor", runNos, monitor, blocks); });
 }
 
 void MainWindow::muAmps(QString runs, bool checked, QString modified)
@@ -760,6 +1734,12 @@ void MainWindow::muAmps(QString runs, bool checked, QString modified)
     else
         yAxisTitle.remove(modifier);
     window->getChartView()->chart()->axes(Qt::Vertical)[0]->setTitleText(yAxisTitle);
+    // Normalisations are recomputed from raw counts, so removing one needs no data
+    if (!checked)
+    {
+        window->modifyAgainstString("", false);
+        return;
+    }
     HttpRequestInput input(url_str);
     HttpRequestWorker *worker = new HttpRequestWorker(this);
 
@@ -769,6 +1749,20 @@ void MainWindow::muAmps(QString runs, bool checked, QString modified)
     worker->execute(input);
 }
 
+// Get the flight path to a window's spectrum for each of its runs
+void MainWindow::flightPaths(QString type, QString runs, QString spectrum)
+{
+    QPointer<GraphWidget> window = qobject_cast<GraphWidget *>(sender());
+    QString cycle = cyclesMap_[ui_->cycleButton->text()];
+    cycle.replace(0, 7, "cycle").replace(".xml", "");
+
+    fetchRunBlocks("getFlightPaths", cycle, runs.split(";"), type.toLower() + "_" + spectrum,
+                   [=](QJsonArray, QJsonArray blocks) {
+                       if (window)
+                           window->setFlightPaths(spectrum, blocks);
+                   });
+}
+
 void MainWindow::runDivide(QString currentDetector, QString run, bool checked)
 {
     auto *window = qobject_cast<GraphWidget *>(sender());
@@ -781,16 +1775,16 @@ void MainWindow::runDivide(QString currentDetector, QString run, bool checked)
         yAxisTitle.remove(modifier);
     window->getChartView()->chart()->axes(Qt::Vertical)[0]->setTitleText(yAxisTitle);
 
+    if (!checked)
+    {
+        window->modifyAgainstBlocks(QJsonArray(), false);
+        return;
+    }
+
     QString cycle = cyclesMap_[ui_->cycleButton->text()];
     cycle.replace(0, 7, "cycle").replace(".xml", "");
-    QString url_str = "http://127.0.0.1:5000/getSpectrum/" + instName_ + "/" + cycle + "/" + run + "/" + currentDetector;
-    HttpRequestInput input(url_str);
-    HttpRequestWorker *worker = new HttpRequestWorker(this);
-
-    // Call result handler when request completed
-    connect(worker, &HttpRequestWorker::on_execution_finished,
-            [=](HttpRequestWorker *workerProxy) { window->modifyAgainstWorker(workerProxy, checked); });
-    worker->execute(input);
+    fetchRunBlocks("getSpectrum", cycle, QStringList(run), currentDetector,
+                   [=](QJsonArray, QJsonArray blocks) { window->modifyAgainstBlocks(blocks, true); });
 }
 
 void MainWindow::monDivide(QString currentRun, QString mon, bool checked)
@@ -805,14 +1799,14 @@ void MainWindow::monDivide(QString currentRun, QString mon, bool checked)
         yAxisTitle.remove(modifier);
     window->getChartView()->chart()->axes(Qt::Vertical)[0]->setTitleText(yAxisTitle);
 
+    if (!checked)
+    {
+        window->modifyAgainstBlocks(QJsonArray(), false);
+        return;
+    }
+
     QString cycle = cyclesMap_[ui_->cycleButton->text()];
     cycle.replace(0, 7, "cycle").replace(".xml", "");
-    QString url_str = "http://127.0.0.1:5000/getMonSpectrum/" + instName_ + "/" + cycle + "/" + currentRun + "/" + mon;
-    HttpRequestInput input(url_str);
-    HttpRequestWorker *worker = new HttpRequestWorker(this);
-
-    // Call result handler when request completed
-    connect(worker, &HttpRequestWorker::on_execution_finished,
-            [=](HttpRequestWorker *workerProxy) { window->modifyAgainstWorker(workerProxy, checked); });
-    worker->execute(input);
+    fetchRunBlocks("getMonSpectrum", cycle, currentRun.split(";"), mon,
+                   [=](QJsonArray, QJsonArray blocks) { window->modifyAgainstBlocks(blocks, true); });
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "peakfinder.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+PeakFinder::PeakFinder(int smoothing, int backgroundWidth, double threshold)
+    : smoothing_(smoothing), backgroundWidth_(backgroundWidth), threshold_(threshold)
+{
+}
+
+// Differences of a prefix sum, so the cost does not grow with the window
+void PeakFinder::movingAverage(const double *in, double *out, int size, int halfWidth, QVector<double> &scratch)
+{
+    scratch.resize(size + 1);
+    auto *prefix = scratch.data();
+    prefix[0] = 0.0;
+    for (auto i = 0; i < size; ++i)
+        prefix[i + 1] = prefix[i] + in[i];
+    for (auto i = 0; i < size; ++i)
+    {
+        auto first = std::max(i - halfWidth, 0);
+        auto last = std::min(i + halfWidth + 1, size);
+        out[i] = (prefix[last] - prefix[first]) / (last - first);
+    }
+}
+
+// van Herk/Gil-Werman: minima running forwards and backwards within blocks of the window width, padded past the
+// ends, combine to give the minimum of any window
+void PeakFinder::movingMinimum(const double *in, double *out, int size, int halfWidth, QVector<double> &scratch)
+{
+    auto width = 2 * halfWidth + 1;
+    auto padded = size + 2 * halfWidth;
+    auto blocks = (padded + width - 1) / width;
+    scratch.fill(std::numeric_limits<double>::max(), blocks * width * 2);
+    auto *forward = scratch.data();
+    auto *backward = forward + blocks * width;
+    std::copy(in, in + size, forward + halfWidth);
+    std::copy(in, in + size, backward + halfWidth);
+    for (auto block = 0; block < blocks; ++block)
+    {
+        auto *f = forward + block * width;
+        auto *b = backward + block * width;
+        for (auto i = 1; i < width; ++i)
+            f[i] = std::min(f[i], f[i - 1]);
+        for (auto i = width - 2; i >= 0; --i)
+            b[i] = std::min(b[i], b[i + 1]);
+    }
+    // Window about in[i] covers padded [i, i + width - 1]
+    for (auto i = 0; i < size; ++i)
+        out[i] = std::min(backward[i], forward[i + width - 1]);
+}
+
+QVector<PeakFinder::Peak> PeakFinder::find(const double *counts, int size) const
+{
+    QVector<Peak> peaks;
+    if (size < 3)
+        return peaks;
+
+    QVector<double> scratch;
+    QVector<double> smoothed(size);
+    QVector<double> minimum(size);
+    QVector<double> background(size);
+    auto *s = smoothed.data();
+    auto *b = background.data();
+    movingAverage(counts, s, size, smoothing_, scratch);
+    movingMinimum(s, minimum.data(), size, backgroundWidth_, scratch);
+    movingAverage(minimum.constData(), b, size, backgroundWidth_, scratch);
+
+    // Significance of each bin above the background, over contiguous arrays without branches
+    QVector<double> significance(size);
+    auto *sig = significance.data();
+    for (auto i = 0; i < size; ++i)
+        sig[i] = (s[i] - b[i]) / std::sqrt(std::max(b[i], 1.0));
+
+    for (auto i = 1; i < size - 1; ++i)
+    {
+        if (sig[i] < threshold_ || s[i] <= s[i - 1] || s[i] < s[i + 1])
+            continue;
+        // Refine the maximum through a parabola over its neighbours
+        auto curvature = s[i - 1] - 2 * s[i] + s[i + 1];
+        auto offset = curvature < 0.0 ? 0.5 * (s[i - 1] - s[i + 1]) / curvature : 0.0;
+        Peak peak{i + offset, s[i] - b[i], sig[i]};
+        // Maxima within the smoothing window of one another are one peak
+        if (!peaks.isEmpty() && peak.bin - peaks.last().bin <= smoothing_)
+        {
+            if (peak.height > peaks.last().height)
+                peaks.last() = peak;
+            continue;
+        }
+        peaks.append(peak);
+    }
+    return peaks;
+}
+
+QVector<PeakFinder::Peak> PeakFinder::find(const QVector<double> &counts) const
+{
+    return find(counts.constData(), counts.size());
+}
+
+QVector<QVector<PeakFinder::Peak>> PeakFinder::findAll(const QVector<float> &counts, int spectra, int bins) const
+{
+    QVector<int> indices(spectra);
+    std::iota(indices.begin(), indices.end(), 0);
+    return QtConcurrent::blockingMapped<QVector<QVector<Peak>>>(indices, [=, &counts](int spectrum) {
+        const auto *row = counts.constData() + qint64(spectrum) * bins;
+        QVector<double> values(row, row + bins);
+        return find(values.constData(), bins);
+    });
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef PEAKFINDER_H
+#define PEAKFINDER_H
+
+#include <QVector>
+
+// Finds peaks in histogrammed counts. Counts are smoothed with a moving average, a background is estimated as the
+// moving average of their moving minimum, and local maxima standing far enough above it (measured in standard
+// deviations of a Poisson background) are kept
+class PeakFinder
+{
+    public:
+    PeakFinder(int smoothing = 3, int backgroundWidth = 50, double threshold = 5.0);
+
+    struct Peak
+    {
+        // Fractional bin index of the maximum
+        double bin;
+        // Smoothed height above background
+        double height;
+        // Height in standard deviations of the background
+        double significance;
+    };
+
+    // Peaks in counts, in order of bin
+    QVector<Peak> find(const double *counts, int size) const;
+    QVector<Peak> find(const QVector<double> &counts) const;
+    // Peaks of every spectrum of row major counts, found in parallel
+    QVector<QVector<Peak>> findAll(const QVector<float> &counts, int spectra, int bins) const;
+
+    private:
+    // Half widths of the smoothing and background windows, in bins
+    int smoothing_;
+    int backgroundWidth_;
+    double threshold_;
+
+    // Mean over a window of 2 * halfWidth + 1 bins, truncated at the ends
+    static void movingAverage(const double *in, double *out, int size, int halfWidth, QVector<double> &scratch);
+    // Minimum over a window of 2 * halfWidth + 1 bins, in time independent of the window
+    static void movingMinimum(const double *in, double *out, int size, int halfWidth, QVector<double> &scratch);
+};
+
+#endif // PEAKFINDER_H
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "rebin.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Fraction of a bin by which a span may exceed a whole number of bins and still be taken as that number
+const double BinTolerance = 1e-9;
+
+QVector<double> Rebin::linear(double min, double max, double width)
+{
+    QVector<double> boundaries;
+    if (!(width > 0.0) || !(max > min))
+        return boundaries;
+    // Spans a whole number of widths long can divide to just above it, which would add a bin of no width
+    auto bins = std::max((int)std::ceil((max - min) / width - BinTolerance), 1);
+    boundaries.resize(bins + 1);
+    auto *x = boundaries.data();
+    for (auto i = 0; i < bins; ++i)
+        x[i] = min + i * width;
+    x[bins] = max;
+    return boundaries;
+}
+
+QVector<double> Rebin::logarithmic(double min, double max, double fraction)
+{
+    QVector<double> boundaries;
+    if (!(fraction > 0.0) || !(min > 0.0) || !(max > min))
+        return boundaries;
+    auto bins = std::max((int)std::ceil(std::log(max / min) / std::log1p(fraction) - BinTolerance), 1);
+    boundaries.resize(bins + 1);
+    auto *x = boundaries.data();
+    auto logStep = std::log1p(fraction);
+    for (auto i = 0; i < bins; ++i)
+        x[i] = min * std::exp(i * logStep);
+    x[bins] = max;
+    return boundaries;
+}
+
+// Interpolate the cumulative count at each new boundary and difference adjacent values. Only locating the boundaries
+// is a (single, merging) pass with branches; the arithmetic runs over contiguous arrays
+QVector<double> Rebin::counts(const QVector<double> &boundaries, const QVector<double> &counts,
+                              const QVector<double> &newBoundaries)
+{
+    auto bins = std::min((int)counts.size(), (int)boundaries.size() - 1);
+    auto newBins = (int)newBoundaries.size() - 1;
+    QVector<double> rebinned(std::max(newBins, 0), 0.0);
+    if (bins < 1 || newBins < 1)
+        return rebinned;
+
+    QVector<double> cumulative(bins + 1);
+    cumulative[0] = 0.0;
+    for (auto i = 0; i < bins; ++i)
+        cumulative[i + 1] = cumulative[i] + counts[i];
+
+    // Original bin holding each new boundary, clamped so boundaries outside the range land on the first or last
+    QVector<int> lower(newBins + 1);
+    auto bin = 0;
+    for (auto j = 0; j <= newBins; ++j)
+    {
+        while (bin < bins - 1 && boundaries[bin + 1] <= newBoundaries[j])
+            ++bin;
+        lower[j] = bin;
+    }
+
+    QVector<double> atBoundary(newBins + 1);
+    const auto *x = boundaries.constData();
+    const auto *y = counts.constData();
+    const auto *c = cumulative.constData();
+    const auto *b = lower.constData();
+    const auto *newX = newBoundaries.constData();
+    auto *at = atBoundary.data();
+    for (auto j = 0; j <= newBins; ++j)
+    {
+        auto width = std::max(x[b[j] + 1] - x[b[j]], std::numeric_limits<double>::min());
+        auto fraction = std::clamp((newX[j] - x[b[j]]) / width, 0.0, 1.0);
+        at[j] = c[b[j]] + fraction * y[b[j]];
+    }
+
+    auto *out = rebinned.data();
+    for (auto j = 0; j < newBins; ++j)
+        out[j] = at[j + 1] - at[j];
+    return rebinned;
+}
@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef REBIN_H
+#define REBIN_H
+
+#include <QVector>
+
+// Histogram rebinning. Boundaries are ascending, with one more boundary than there are bins
+namespace Rebin
+{
+// Bins of the given width from min to max, the last of which may be narrower
+QVector<double> linear(double min, double max, double width);
+// Bins each a constant fraction (dT/T) wider than their start from min to max, where min is positive
+QVector<double> logarithmic(double min, double max, double fraction);
+// Redistribute counts onto new boundaries, treating counts as spread evenly across each original bin so totals
+// are conserved. New bins outside the original range get nothing
+QVector<double> counts(const QVector<double> &boundaries, const QVector<double> &counts,
+                       const QVector<double> &newBoundaries);
+} // namespace Rebin
+
+#endif // REBIN_H
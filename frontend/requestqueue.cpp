@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "requestqueue.h"
+#include <algorithm>
+
+RequestQueue::RequestQueue(QStringList urls, int maxActive, QObject *parent)
+    : QObject(parent), urls_(urls), maxActive_(std::max(maxActive, 1)), next_(0), completed_(0)
+{
+}
+
+void RequestQueue::start()
+{
+    while (active_.size() < maxActive_ && next_ < urls_.size())
+        startNext();
+    if (urls_.isEmpty())
+        emit finished();
+}
+
+int RequestQueue::count() const { return urls_.size(); }
+int RequestQueue::completed() const { return completed_; }
+bool RequestQueue::isActive() const { return !active_.isEmpty() || next_ < urls_.size(); }
+
+void RequestQueue::cancel()
+{
+    next_ = urls_.size();
+    // Deleting a worker deletes its network manager, aborting the reply
+    for (auto *worker : active_)
+        delete worker;
+    active_.clear();
+}
+
+void RequestQueue::startNext()
+{
+    auto index = next_++;
+    HttpRequestInput input(urls_[index]);
+    auto *worker = new HttpRequestWorker(this);
+    active_.append(worker);
+    connect(worker, &HttpRequestWorker::on_execution_finished, this, [=]() {
+        active_.removeOne(worker);
+        ++completed_;
+        emit requestFinished(index, worker);
+        worker->deleteLater();
+
+        if (next_ < urls_.size())
+            startNext();
+        else if (active_.isEmpty())
+            emit finished();
+    });
+    worker->execute(input);
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef REQUESTQUEUE_H
+#define REQUESTQUEUE_H
+
+#include "httprequestworker.h"
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+// Runs a list of requests with a limited number in flight, reporting each result as it arrives
+class RequestQueue : public QObject
+{
+    Q_OBJECT
+
+    public:
+    RequestQueue(QStringList urls, int maxActive, QObject *parent = nullptr);
+
+    void start();
+    int count() const;
+    int completed() const;
+    bool isActive() const;
+
+    public slots:
+    // Abort requests in flight and drop those not yet sent
+    void cancel();
+
+    signals:
+    // Worker is deleted once control returns to the event loop
+    void requestFinished(int index, HttpRequestWorker *worker);
+    void finished();
+
+    private:
+    QStringList urls_;
+    int maxActive_;
+    int next_;
+    int completed_;
+    QList<HttpRequestWorker *> active_;
+
+    private:
+    void startNext();
+};
+
+#endif // REQUESTQUEUE_H
@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "seriesbuffer.h"
+#include "seriescodec.h"
+#include <QDataStream>
+#include <QIODevice>
+#include <algorithm>
+#include <atomic>
+
+// Samples in each compressed block, which also bounds the scan per decimation bucket through its min/max summary
+const int SummaryBlock = 256;
+// Decoded blocks kept by each thread, enough for a merge over several series to decode each block once
+const int DecodeCacheSize = 16;
+
+struct SeriesBuffer::DecodedBlock
+{
+    quint64 owner;
+    int index;
+    double x[SummaryBlock];
+    double y[SummaryBlock];
+};
+
+SeriesBuffer::SeriesBuffer(QVector<double> x, QVector<double> y, Interpolation interpolation)
+    : size_(x.size()), minY_(0.0), maxY_(0.0), interpolation_(interpolation)
+{
+    static std::atomic<quint64> nextId(1);
+    id_ = nextId++;
+
+    // Single pass reduction over the contiguous values
+    if (!y.isEmpty())
+    {
+        auto range = std::minmax_element(y.cbegin(), y.cend());
+        minY_ = *range.first;
+        maxY_ = *range.second;
+    }
+
+    auto blocks = (size_ + SummaryBlock - 1) / SummaryBlock;
+    blockOffset_.resize(blocks);
+    blockX_.resize(blocks);
+    blockMin_.resize(blocks);
+    blockMax_.resize(blocks);
+    blockMinX_.resize(blocks);
+    blockMinY_.resize(blocks);
+    blockMaxX_.resize(blocks);
+    blockMaxY_.resize(blocks);
+    // Slowly varying logs typically take a quarter of their raw size
+    words_.reserve(size_ / 2 + blocks * 3);
+    qint64 bitCount = 0;
+    for (auto block = 0; block < blocks; ++block)
+    {
+        auto first = block * SummaryBlock;
+        auto count = std::min(SummaryBlock, size_ - first);
+        auto begin = y.cbegin() + first;
+        // Separate passes, as minmax_element finds the last maximum whereas buckets keep the first
+        blockMin_[block] = std::min_element(begin, begin + count) - y.cbegin();
+        blockMax_[block] = std::max_element(begin, begin + count) - y.cbegin();
+        blockMinX_[block] = x[blockMin_[block]];
+        blockMinY_[block] = y[blockMin_[block]];
+        blockMaxX_[block] = x[blockMax_[block]];
+        blockMaxY_[block] = y[blockMax_[block]];
+        blockX_[block] = x[first];
+        blockOffset_[block] = SeriesCodec::encode(x.constData() + first, y.constData() + first, count, words_, bitCount);
+    }
+    words_.squeeze();
+}
+
+int SeriesBuffer::size() const { return size_; }
+double SeriesBuffer::x(int index) const { return block(index / SummaryBlock).x[index % SummaryBlock]; }
+double SeriesBuffer::y(int index) const { return block(index / SummaryBlock).y[index % SummaryBlock]; }
+double SeriesBuffer::minY() const { return minY_; }
+double SeriesBuffer::maxY() const { return maxY_; }
+SeriesBuffer::Interpolation SeriesBuffer::interpolation() const { return interpolation_; }
+
+const SeriesBuffer::DecodedBlock &SeriesBuffer::block(int index) const
+{
+    // Per thread, so concurrent readers never contend, and shared by every buffer so idle ones hold no decoded data
+    thread_local DecodedBlock cache[DecodeCacheSize] = {};
+    thread_local int latest = 0;
+    thread_local int next = 0;
+    if (cache[latest].owner == id_ && cache[latest].index == index)
+        return cache[latest];
+    for (auto i = 0; i < DecodeCacheSize; ++i)
+        if (cache[i].owner == id_ && cache[i].index == index)
+        {
+            latest = i;
+            return cache[i];
+        }
+
+    latest = next;
+    next = (next + 1) % DecodeCacheSize;
+    auto &decoded = cache[latest];
+    decoded.owner = id_;
+    decoded.index = index;
+    SeriesCodec::decode(words_, blockOffset_[index], std::min(SummaryBlock, size_ - index * SummaryBlock), decoded.x,
+                        decoded.y);
+    return decoded;
+}
+
+int SeriesBuffer::partitionPoint(int begin, int end, const std::function<bool(double)> &test) const
+{
+    if (begin >= end)
+        return begin;
+
+    // Find the block holding the point from the first x of each, then search only that block
+    auto beginBlock = begin / SummaryBlock;
+    auto endBlock = (end - 1) / SummaryBlock;
+    auto found = int(std::partition_point(blockX_.cbegin() + beginBlock + 1, blockX_.cbegin() + endBlock + 1, test) -
+                     blockX_.cbegin()) -
+                 1;
+    auto blockStart = found * SummaryBlock;
+    const auto &decoded = block(found);
+    auto from = std::max(begin, blockStart) - blockStart;
+    auto to = std::min(end, blockStart + SummaryBlock) - blockStart;
+    return int(std::partition_point(decoded.x + from, decoded.x + to, test) - decoded.x) + blockStart;
+}
+
+int SeriesBuffer::lowerBound(double x) const
+{
+    return partitionPoint(0, size_, [x](double sampleX) { return sampleX < x; });
+}
+
+// Reduce the samples in view to the first, min, max and last point of each bucket (pixel column), so that
+// the drawn line is indistinguishable from the full data and spikes are never dropped
+QList<QPointF> SeriesBuffer::decimated(double xMin, double xMax, int buckets, double xScale, double xOffset) const
+{
+    QList<QPointF> points;
+    if (size_ == 0 || xScale <= 0)
+        return points;
+
+    // Include one sample either side of the view so lines reach the edges
+    auto first = 0;
+    auto last = size_;
+    if (xMax > xMin)
+    {
+        first = std::max(lowerBound((xMin - xOffset) / xScale) - 1, 0);
+        last = std::min(lowerBound((xMax - xOffset) / xScale) + 1, size_);
+    }
+    if (last <= first)
+        return points;
+
+    buckets = std::max(buckets, 1);
+    if (last - first <= buckets * 4)
+    {
+        points.reserve(last - first);
+        for (auto i = first; i < last; ++i)
+            points.append(QPointF(x(i) * xScale + xOffset, y(i)));
+        return interpolation_ == Step ? toSteps(points) : points;
+    }
+
+    points.reserve(buckets * 4 + 2);
+    auto x0 = x(first);
+    auto bucketWidth = (x(last - 1) - x0) / buckets;
+    if (bucketWidth <= 0)
+        bucketWidth = 1.0;
+
+    auto bucketStart = first;
+    while (bucketStart < last)
+    {
+        // Samples are sorted, so each bucket ends at the first sample beyond it
+        auto bucket = int((x(bucketStart) - x0) / bucketWidth);
+        auto bucketEnd = partitionPoint(bucketStart + 1, last,
+                                        [=](double sampleX) { return int((sampleX - x0) / bucketWidth) == bucket; });
+        int minIndex;
+        int maxIndex;
+        QPointF minPoint;
+        QPointF maxPoint;
+        extremes(bucketStart, bucketEnd, minIndex, maxIndex, minPoint, maxPoint);
+
+        // Emit in sample order, skipping repeats
+        std::pair<int, QPointF> samples[4] = {{bucketStart, QPointF(x(bucketStart), y(bucketStart))},
+                                              {minIndex, minPoint},
+                                              {maxIndex, maxPoint},
+                                              {bucketEnd - 1, QPointF(x(bucketEnd - 1), y(bucketEnd - 1))}};
+        if (maxIndex < minIndex)
+            std::swap(samples[1], samples[2]);
+        auto previous = -1;
+        for (const auto &sample : samples)
+        {
+            if (sample.first == previous)
+                continue;
+            points.append(QPointF(sample.second.x() * xScale + xOffset, sample.second.y()));
+            previous = sample.first;
+        }
+        bucketStart = bucketEnd;
+    }
+    return interpolation_ == Step ? toSteps(points) : points;
+}
+
+QList<QPointF> SeriesBuffer::thinned(double xMin, double xMax, double yMin, double yMax, int columns, int rows,
+                                     double xScale, double xOffset) const
+{
+    QList<QPointF> points;
+    if (size_ == 0 || xScale <= 0 || xMax <= xMin || yMax <= yMin)
+        return points;
+
+    auto first = lowerBound((xMin - xOffset) / xScale);
+    auto last = lowerBound((xMax - xOffset) / xScale);
+    columns = std::max(columns, 1);
+    rows = std::max(rows, 1);
+    if (last - first <= columns * 4)
+    {
+        for (auto i = first; i < last; ++i)
+        {
+            auto value = y(i);
+            if (value >= yMin && value <= yMax)
+                points.append(QPointF(x(i) * xScale + xOffset, value));
+        }
+        return points;
+    }
+
+    // Samples are sorted in x, so only those in view are visited
+    QVector<bool> occupied(qint64(columns) * rows, false);
+    auto xPerCell = columns / (xMax - xMin);
+    auto yPerCell = rows / (yMax - yMin);
+    for (auto i = first; i < last; ++i)
+    {
+        auto value = y(i);
+        if (value < yMin || value > yMax)
+            continue;
+        auto viewX = x(i) * xScale + xOffset;
+        auto column = std::min(int((viewX - xMin) * xPerCell), columns - 1);
+        auto row = std::min(int((value - yMin) * yPerCell), rows - 1);
+        auto cell = qint64(row) * columns + column;
+        if (occupied[cell])
+            continue;
+        occupied[cell] = true;
+        points.append(QPointF(viewX, value));
+    }
+    return points;
+}
+
+void SeriesBuffer::extremes(int begin, int end, int &minIndex, int &maxIndex, QPointF &minPoint,
+                            QPointF &maxPoint) const
+{
+    minIndex = begin;
+    maxIndex = begin;
+    minPoint = QPointF(x(begin), y(begin));
+    maxPoint = minPoint;
+    auto consider = [&](int index, double sampleX, double sampleY)
+    {
+        if (sampleY < minPoint.y())
+        {
+            minIndex = index;
+            minPoint = QPointF(sampleX, sampleY);
+        }
+        if (sampleY > maxPoint.y())
+        {
+            maxIndex = index;
+            maxPoint = QPointF(sampleX, sampleY);
+        }
+    };
+
+    // Scan a range a decoded block at a time
+    auto scan = [&](int from, int to)
+    {
+        while (from < to)
+        {
+            auto blockStart = from / SummaryBlock * SummaryBlock;
+            const auto &decoded = block(from / SummaryBlock);
+            auto stop = std::min(to, blockStart + SummaryBlock);
+            for (auto i = from; i < stop; ++i)
+                consider(i, decoded.x[i - blockStart], decoded.y[i - blockStart]);
+            from = stop;
+        }
+    };
+
+    // Scan up to the first whole block, take whole blocks from their summary, then scan the remainder
+    auto firstBlock = (begin + SummaryBlock - 1) / SummaryBlock;
+    auto lastBlock = end / SummaryBlock;
+    if (firstBlock >= lastBlock)
+    {
+        scan(begin + 1, end);
+        return;
+    }
+    scan(begin + 1, firstBlock * SummaryBlock);
+    for (auto block = firstBlock; block < lastBlock; ++block)
+    {
+        consider(blockMin_[block], blockMinX_[block], blockMinY_[block]);
+        consider(blockMax_[block], blockMaxX_[block], blockMaxY_[block]);
+    }
+    scan(lastBlock * SummaryBlock, end);
+}
+
+QList<QPointF> SeriesBuffer::toSteps(const QList<QPointF> &points) const
+{
+    QList<QPointF> steps;
+    if (points.isEmpty())
+        return steps;
+    steps.reserve(points.size() * 2);
+    steps.append(points.first());
+    for (auto i = 1; i < points.size(); ++i)
+    {
+        if (points[i].y() != points[i - 1].y())
+            steps.append(QPointF(points[i].x(), points[i - 1].y()));
+        steps.append(points[i]);
+    }
+    return steps;
+}
+
+qint64 SeriesBuffer::memoryUsage() const
+{
+    // Each block has an offset, its first x and the min/max summary
+    return words_.capacity() * (qint64)sizeof(quint64) +
+           blockX_.capacity() * (qint64)(sizeof(qint64) + 5 * sizeof(double) + 2 * sizeof(int));
+}
+
+QByteArray SeriesBuffer::toBinary() const
+{
+    // Already compressed, so copied as it is
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << (qint32)size_ << minY_ << maxY_ << (qint32)interpolation_ << words_ << blockOffset_ << blockX_ << blockMin_
+           << blockMax_ << blockMinX_ << blockMinY_ << blockMaxX_ << blockMaxY_;
+    return data;
+}
+
+QSharedPointer<SeriesBuffer> SeriesBuffer::fromBinary(const QByteArray &data)
+{
+    auto buffer = QSharedPointer<SeriesBuffer>::create();
+    qint32 size;
+    qint32 interpolation;
+    QDataStream stream(data);
+    stream >> size >> buffer->minY_ >> buffer->maxY_ >> interpolation >> buffer->words_ >> buffer->blockOffset_ >>
+        buffer->blockX_ >> buffer->blockMin_ >> buffer->blockMax_ >> buffer->blockMinX_ >> buffer->blockMinY_ >>
+        buffer->blockMaxX_ >> buffer->blockMaxY_;
+    buffer->size_ = size;
+    buffer->interpolation_ = Interpolation(interpolation);
+    return buffer;
+}
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef SERIESBUFFER_H
+#define SERIESBUFFER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPointF>
+#include <QSharedPointer>
+#include <QVector>
+#include <functional>
+
+// Full resolution series data, from which decimated views are drawn. Views sharing a buffer may each
+// display it through their own linear x transform (e.g. absolute and run-relative time). Samples are held
+// losslessly compressed in blocks, which are decoded as they are read
+class SeriesBuffer
+{
+    public:
+    // How values between samples are drawn
+    enum Interpolation
+    {
+        Linear,
+        // Values hold until the next sample (e.g. run length compressed state logs)
+        Step
+    };
+    SeriesBuffer(QVector<double> x = QVector<double>(), QVector<double> y = QVector<double>(),
+                 Interpolation interpolation = Linear);
+
+    int size() const;
+    double x(int index) const;
+    double y(int index) const;
+    double minY() const;
+    double maxY() const;
+    Interpolation interpolation() const;
+    // Index of the first sample at or beyond x
+    int lowerBound(double x) const;
+    // Min/max decimated points covering the transformed range [xMin, xMax]
+    QList<QPointF> decimated(double xMin, double xMax, int buckets, double xScale = 1.0, double xOffset = 0.0) const;
+    // For scatter plots: the first point falling in each cell of a columns by rows grid over the transformed view
+    QList<QPointF> thinned(double xMin, double xMax, double yMin, double yMax, int columns, int rows,
+                           double xScale = 1.0, double xOffset = 0.0) const;
+    // Heap held, in bytes
+    qint64 memoryUsage() const;
+    // Compressed copy for plots put aside, and the buffer it came from
+    QByteArray toBinary() const;
+    static QSharedPointer<SeriesBuffer> fromBinary(const QByteArray &data);
+
+    private:
+    int size_;
+    double minY_;
+    double maxY_;
+    Interpolation interpolation_;
+    // Bit stream of SummaryBlock sample blocks, with the offset and first x of each
+    QVector<quint64> words_;
+    QVector<qint64> blockOffset_;
+    QVector<double> blockX_;
+    // Index and sample of the first minimum and maximum in each block
+    QVector<int> blockMin_;
+    QVector<int> blockMax_;
+    QVector<double> blockMinX_;
+    QVector<double> blockMinY_;
+    QVector<double> blockMaxX_;
+    QVector<double> blockMaxY_;
+    // Identifies the buffer's decoded blocks, which are cached per thread
+    quint64 id_;
+
+    struct DecodedBlock;
+    // Decoded block, valid until the next block is decoded on this thread
+    const DecodedBlock &block(int index) const;
+    // First index in [begin, end) whose x fails test, which holds for a leading run of samples
+    int partitionPoint(int begin, int end, const std::function<bool(double)> &test) const;
+    // Indices and samples of the first minimum and maximum value in [begin, end)
+    void extremes(int begin, int end, int &minIndex, int &maxIndex, QPointF &minPoint, QPointF &maxPoint) const;
+    // Insert the corner points of a step plot
+    QList<QPointF> toSteps(const QList<QPointF> &points) const;
+};
+
+#endif // SERIESBUFFER_H
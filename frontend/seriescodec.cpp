@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "seriescodec.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+
+// Widths of signed values after each prefix (0, 10, 110, 1110, 11110, 11111); zero takes the single bit
+const int SignedWidths[] = {7, 12, 20, 32, 64};
+// Bits holding the leading zero count, and the length less one, of an XOR's meaningful bits
+const int LeadingBits = 5;
+const int LengthBits = 6;
+
+namespace SeriesCodec
+{
+BitWriter::BitWriter(QVector<quint64> &words, qint64 &bitCount) : words_(words), bitCount_(bitCount) {}
+
+void BitWriter::write(quint64 value, int bits)
+{
+    if (bits < 64)
+        value &= (quint64(1) << bits) - 1;
+    auto used = int(bitCount_ % 64);
+    if (used == 0)
+        words_.append(0);
+    auto free = 64 - used;
+    if (bits <= free)
+        words_.last() |= value << (free - bits);
+    else
+    {
+        words_.last() |= value >> (bits - free);
+        words_.append(value << (64 - (bits - free)));
+    }
+    bitCount_ += bits;
+}
+
+void BitWriter::writeSigned(qint64 value)
+{
+    if (value == 0)
+    {
+        write(0, 1);
+        return;
+    }
+    for (auto i = 0; i < 5; ++i)
+    {
+        auto bits = SignedWidths[i];
+        if (bits < 64 && (value < -(qint64(1) << (bits - 1)) || value >= (qint64(1) << (bits - 1))))
+            continue;
+        // Prefix of i + 1 ones, ended by a zero except for the widest
+        if (i < 4)
+            write(((quint64(1) << (i + 1)) - 1) << 1, i + 2);
+        else
+            write(0x1f, 5);
+        write(quint64(value), bits);
+        return;
+    }
+}
+
+BitReader::BitReader(const QVector<quint64> &words, qint64 offset) : words_(words), position_(offset) {}
+
+quint64 BitReader::peek() const
+{
+    auto word = position_ >> 6;
+    auto used = int(position_ & 63);
+    auto bits = words_[word] << used;
+    if (used > 0 && word + 1 < quint64(words_.size()))
+        bits |= words_[word + 1] >> (64 - used);
+    return bits;
+}
+
+quint64 BitReader::read(int bits)
+{
+    auto value = peek() >> (64 - bits);
+    position_ += bits;
+    return value;
+}
+
+qint64 BitReader::readSigned()
+{
+    // Count the prefix's ones at once, consuming its terminating zero if it has one
+    auto ones = std::min(int(qCountLeadingZeroBits(~peek())), 5);
+    position_ += ones < 5 ? ones + 1 : ones;
+    if (ones == 0)
+        return 0;
+    auto bits = SignedWidths[ones - 1];
+    auto value = read(bits);
+    // Sign extend
+    if (bits < 64 && (value >> (bits - 1)) & 1)
+        value |= ~quint64(0) << bits;
+    return qint64(value);
+}
+
+qint64 encode(const double *x, const double *y, int count, QVector<quint64> &words, qint64 &bitCount)
+{
+    auto offset = bitCount;
+    if (count <= 0)
+        return offset;
+    BitWriter writer(words, bitCount);
+
+    // Times are usually read from single precision logs, so share a run of trailing zero bits which is dropped
+    QVector<quint64> patterns(count);
+    std::memcpy(patterns.data(), x, count * sizeof(double));
+    auto shift = 63;
+    for (auto pattern : patterns)
+        if (pattern != 0)
+            shift = std::min(shift, int(qCountTrailingZeroBits(pattern)));
+    quint64 previousY;
+    std::memcpy(&previousY, y, sizeof(double));
+    writer.write(shift, 6);
+    writer.write(patterns[0], 64);
+    writer.write(previousY, 64);
+
+    quint64 previousDelta = 0;
+    auto leading = -1;
+    auto trailing = 0;
+    for (auto i = 1; i < count; ++i)
+    {
+        // Wrapping differences of the shifted patterns are lossless whatever their order
+        auto delta = (patterns[i] >> shift) - (patterns[i - 1] >> shift);
+        writer.writeSigned(qint64(delta - previousDelta));
+        previousDelta = delta;
+
+        quint64 value;
+        std::memcpy(&value, y + i, sizeof(double));
+        auto difference = value ^ previousY;
+        previousY = value;
+        if (difference == 0)
+        {
+            writer.write(0, 1);
+            continue;
+        }
+        auto newLeading = std::min(int(qCountLeadingZeroBits(difference)), (1 << LeadingBits) - 1);
+        auto newTrailing = int(qCountTrailingZeroBits(difference));
+        if (leading != -1 && newLeading >= leading && newTrailing >= trailing)
+        {
+            // Fits within the previous window of meaningful bits
+            writer.write(0b10, 2);
+            writer.write(difference >> trailing, 64 - leading - trailing);
+            continue;
+        }
+        leading = newLeading;
+        trailing = newTrailing;
+        auto length = 64 - leading - trailing;
+        writer.write(0b11, 2);
+        writer.write(leading, LeadingBits);
+        writer.write(length - 1, LengthBits);
+        writer.write(difference >> trailing, length);
+    }
+    return offset;
+}
+
+void decode(const QVector<quint64> &words, qint64 offset, int count, double *x, double *y)
+{
+    if (count <= 0)
+        return;
+    BitReader reader(words, offset);
+    auto shift = int(reader.read(6));
+    auto pattern = reader.read(64);
+    auto previousY = reader.read(64);
+    std::memcpy(x, &pattern, sizeof(double));
+    std::memcpy(y, &previousY, sizeof(double));
+
+    auto shifted = pattern >> shift;
+    quint64 delta = 0;
+    auto leading = 0;
+    auto trailing = 0;
+    for (auto i = 1; i < count; ++i)
+    {
+        delta += quint64(reader.readSigned());
+        shifted += delta;
+        pattern = shifted << shift;
+        std::memcpy(x + i, &pattern, sizeof(double));
+
+        if (reader.read(1) == 1)
+        {
+            if (reader.read(1) == 1)
+            {
+                leading = int(reader.read(LeadingBits));
+                trailing = 64 - leading - int(reader.read(LengthBits)) - 1;
+            }
+            previousY ^= reader.read(64 - leading - trailing) << trailing;
+        }
+        std::memcpy(y + i, &previousY, sizeof(double));
+    }
+}
+} // namespace SeriesCodec
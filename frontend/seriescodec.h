@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef SERIESCODEC_H
+#define SERIESCODEC_H
+
+#include <QVector>
+#include <QtGlobal>
+
+// Lossless, Gorilla style compression of series samples into a bit stream. Times (x) are stored as the delta of
+// deltas of their IEEE bit patterns, so regularly spaced samples take a bit each, and values (y) as the XOR with the
+// previous value, so repeats take a bit and small changes only their differing bits. Samples are written in blocks
+// that each begin with raw values, so any block can be decoded alone
+namespace SeriesCodec
+{
+// Append a block of count samples to the stream, returning its starting bit offset
+qint64 encode(const double *x, const double *y, int count, QVector<quint64> &words, qint64 &bitCount);
+// Decode the block of count samples starting at the given bit offset
+void decode(const QVector<quint64> &words, qint64 offset, int count, double *x, double *y);
+
+// Most significant bit first packing of values into 64-bit words
+class BitWriter
+{
+    public:
+    BitWriter(QVector<quint64> &words, qint64 &bitCount);
+    // Write the low bits (1 to 64) of value
+    void write(quint64 value, int bits);
+    // Write a signed value in the smallest of a few prefixed widths
+    void writeSigned(qint64 value);
+
+    private:
+    QVector<quint64> &words_;
+    qint64 &bitCount_;
+};
+
+class BitReader
+{
+    public:
+    BitReader(const QVector<quint64> &words, qint64 offset);
+    // Next 64 bits of the stream, most significant first, without consuming them
+    quint64 peek() const;
+    quint64 read(int bits);
+    qint64 readSigned();
+
+    private:
+    const QVector<quint64> &words_;
+    quint64 position_;
+};
+} // namespace SeriesCodec
+
+#endif // SERIESCODEC_H
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "serieslayer.h"
+#include <QChart>
+#include <QDateTimeAxis>
+#include <QPainter>
+#include <QScatterSeries>
+#include <QValueAxis>
+#include <algorithm>
+#include <cmath>
+
+// Stacking among the chart's own items, level with its series and so above grid lines and shading
+const qreal SeriesZValue = 4;
+// Relative change in bucket width treated as a zoom, beyond the rounding of a pan's shifted axis range
+const qreal RescaleTolerance = 1e-6;
+
+SeriesLayer::SeriesLayer(QChart *chart) : QGraphicsItem(chart), buckets_(1)
+{
+    setZValue(SeriesZValue);
+    // Hover labels and rubber bands repaint over a cached image rather than redrawing the data
+    setCacheMode(QGraphicsItem::DeviceCoordinateCache);
+    setPlotArea(chart->plotArea());
+    setVisible(false);
+}
+
+void SeriesLayer::setSources(const QVector<Source> &sources, int buckets)
+{
+    sources_ = sources;
+    buckets_ = std::max(buckets, 1);
+    // Keep the decimations of series still drawn for the next frame of a pan, releasing the rest with their buffers
+    for (auto it = decimations_.begin(); it != decimations_.end();)
+        if (std::none_of(sources_.cbegin(), sources_.cend(),
+                         [&](const Source &source) { return source.series == it.key(); }))
+            it = decimations_.erase(it);
+        else
+            ++it;
+    setVisible(!sources_.isEmpty());
+    update();
+}
+
+void SeriesLayer::removeSeries(QXYSeries *series)
+{
+    sources_.erase(std::remove_if(sources_.begin(), sources_.end(),
+                                  [=](const Source &source) { return source.series == series; }),
+                   sources_.end());
+    decimations_.remove(series);
+    setVisible(!sources_.isEmpty());
+    update();
+}
+
+void SeriesLayer::setPlotArea(const QRectF &plotArea)
+{
+    prepareGeometryChange();
+    plotArea_ = plotArea;
+}
+
+QRectF SeriesLayer::boundingRect() const { return plotArea_; }
+
+bool SeriesLayer::axisRange(QAbstractAxis *axis, qreal &min, qreal &max)
+{
+    if (auto *dateTimeAxis = qobject_cast<QDateTimeAxis *>(axis))
+    {
+        min = dateTimeAxis->min().toMSecsSinceEpoch();
+        max = dateTimeAxis->max().toMSecsSinceEpoch();
+        return max > min;
+    }
+    if (auto *valueAxis = qobject_cast<QValueAxis *>(axis))
+    {
+        min = valueAxis->min();
+        max = valueAxis->max();
+        return max > min;
+    }
+    return false;
+}
+
+QList<QPointF> SeriesLayer::decimated(const Source &source, qreal minX, qreal maxX)
+{
+    auto span = maxX - minX;
+    auto bucketWidth = span / buckets_;
+    auto &decimation = decimations_[source.series];
+    auto sameScale = decimation.data == source.data && decimation.xScale == source.xScale &&
+                     decimation.xOffset == source.xOffset &&
+                     std::abs(decimation.bucketWidth - bucketWidth) <= bucketWidth * RescaleTolerance;
+    if (!sameScale || minX < decimation.minX || maxX > decimation.maxX)
+    {
+        // A view which moved at the same scale is being panned, so take a view width either side for the frames to
+        // come. Zooms take only the view, as their next frame is at another scale
+        auto margin = sameScale ? span : 0.0;
+        decimation = {source.data,
+                      source.xScale,
+                      source.xOffset,
+                      minX - margin,
+                      maxX + margin,
+                      bucketWidth,
+                      source.data->decimated(minX - margin, maxX + margin, buckets_ * (sameScale ? 3 : 1),
+                                             source.xScale, source.xOffset)};
+    }
+
+    // Points are in x order, so the view's are found by bisection, with one either side so lines reach the edges
+    const auto &points = decimation.points;
+    auto before = [](const QPointF &point, qreal x) { return point.x() < x; };
+    auto first = std::lower_bound(points.cbegin(), points.cend(), minX, before);
+    auto last = std::lower_bound(first, points.cend(), maxX, before);
+    if (first != points.cbegin())
+        --first;
+    if (last != points.cend())
+        ++last;
+    return QList<QPointF>(first, last);
+}
+
+void SeriesLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+    if (plotArea_.isEmpty())
+        return;
+
+    painter->setClipRect(plotArea_);
+    for (const auto &source : sources_)
+    {
+        if (!source.series->isVisible())
+            continue;
+
+        qreal minX = 0.0;
+        qreal maxX = 0.0;
+        qreal minY = 0.0;
+        qreal maxY = 0.0;
+        auto ranged = 0;
+        for (auto *axis : source.series->attachedAxes())
+            if (axis->orientation() == Qt::Horizontal ? axisRange(axis, minX, maxX) : axisRange(axis, minY, maxY))
+                ++ranged;
+        if (ranged != 2)
+            continue;
+
+        // Decimate lines to the plot width, and thin scatter points to a cell of half a marker, then map onto the
+        // plot in place
+        auto *scatter = qobject_cast<QScatterSeries *>(source.series);
+        QList<QPointF> points;
+        if (scatter)
+        {
+            auto cell = std::max(scatter->markerSize() / 2, 1.0);
+            auto rows = buckets_ * plotArea_.height() / plotArea_.width();
+            points = source.data->thinned(minX, maxX, minY, maxY, int(buckets_ / cell), int(rows / cell),
+                                          source.xScale, source.xOffset);
+        }
+        else
+            points = decimated(source, minX, maxX);
+        auto xPerValue = plotArea_.width() / (maxX - minX);
+        auto yPerValue = plotArea_.height() / (maxY - minY);
+        for (auto &point : points)
+            point = QPointF(plotArea_.left() + (point.x() - minX) * xPerValue,
+                            plotArea_.bottom() - (point.y() - minY) * yPerValue);
+
+        painter->setPen(source.series->pen());
+        if (scatter)
+        {
+            auto radius = scatter->markerSize() / 2;
+            painter->setBrush(scatter->brush());
+            for (const auto &point : points)
+                painter->drawEllipse(point, radius, radius);
+        }
+        else
+            painter->drawPolyline(points.constData(), points.size());
+    }
+}
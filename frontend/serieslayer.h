@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#ifndef SERIESLAYER_H
+#define SERIESLAYER_H
+
+#include "seriesbuffer.h"
+#include <QGraphicsItem>
+#include <QHash>
+#include <QRectF>
+#include <QSharedPointer>
+#include <QVector>
+#include <QXYSeries>
+
+class QAbstractAxis;
+class QChart;
+
+// Draws buffered series straight from their full resolution data with QPainter, in place of the chart's own
+// items. The series themselves are left empty but still supply the pen, visibility, axes and legend entry
+class SeriesLayer : public QGraphicsItem
+{
+    public:
+    SeriesLayer(QChart *chart);
+
+    // A series and the data drawn for it, through its x transform
+    struct Source
+    {
+        QXYSeries *series;
+        QSharedPointer<SeriesBuffer> data;
+        double xScale;
+        double xOffset;
+    };
+    // Draw the sources decimated to the given number of buckets across the plot
+    void setSources(const QVector<Source> &sources, int buckets = 1);
+    void removeSeries(QXYSeries *series);
+    void setPlotArea(const QRectF &plotArea);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+    private:
+    QVector<Source> sources_;
+    int buckets_;
+    QRectF plotArea_;
+    // Line points decimated at the view's bucket width, over a view width either side while it is panned, so most
+    // frames of a pan only select from them rather than decoding samples again
+    struct Decimation
+    {
+        QSharedPointer<SeriesBuffer> data;
+        double xScale;
+        double xOffset;
+        qreal minX;
+        qreal maxX;
+        qreal bucketWidth;
+        QList<QPointF> points;
+    };
+    QHash<QXYSeries *, Decimation> decimations_;
+
+    private:
+    // Visible range of a value or date-time axis, returning false for other axes
+    static bool axisRange(QAbstractAxis *axis, qreal &min, qreal &max);
+    // Decimated points of a line source covering [minX, maxX], redecimated if the view has left them or rescaled
+    QList<QPointF> decimated(const Source &source, qreal minX, qreal maxX);
+};
+
+#endif // SERIESLAYER_H
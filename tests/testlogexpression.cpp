@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "logexpression.h"
+#include <QtTest>
+#include <cmath>
+
+class TestLogExpression : public QObject
+{
+    Q_OBJECT
+
+    private:
+    // Parse text, which must be valid, and evaluate it over the given fields
+    QSharedPointer<SeriesBuffer> evaluate(const QString &text,
+                                          const QHash<QString, QSharedPointer<SeriesBuffer>> &fields);
+    void compare(const QSharedPointer<SeriesBuffer> &actual, const QVector<double> &x, const QVector<double> &y);
+
+    private slots:
+    void parseFields();
+    void parseErrors_data();
+    void parseErrors();
+    void arithmetic();
+    void functions();
+    void derivative();
+    void movingAverage();
+    void undefinedValues();
+    void differentTimes();
+    void missingField();
+};
+
+QSharedPointer<SeriesBuffer> TestLogExpression::evaluate(const QString &text,
+                                                         const QHash<QString, QSharedPointer<SeriesBuffer>> &fields)
+{
+    LogExpression expression;
+    QString error;
+    if (!expression.parse(text, error))
+        qWarning() << error;
+    return expression.evaluate(fields);
+}
+
+void TestLogExpression::compare(const QSharedPointer<SeriesBuffer> &actual, const QVector<double> &x,
+                                const QVector<double> &y)
+{
+    QCOMPARE(actual->size(), (int)x.size());
+    for (auto i = 0; i < x.size(); ++i)
+    {
+        QCOMPARE(actual->x(i), x[i]);
+        QCOMPARE(actual->y(i), y[i]);
+    }
+}
+
+void TestLogExpression::parseFields()
+{
+    LogExpression expression;
+    QString error;
+    QVERIFY(expression.parse(" T_sample - T_setpoint ", error));
+    QCOMPARE(expression.text(), QString("T_sample - T_setpoint"));
+    QCOMPARE(expression.fields(), QStringList({"T_sample", "T_setpoint"}));
+
+    // Fields are listed once, in the order first read, whether plain or quoted
+    QVERIFY(expression.parse("a * \"Field name\" + a / sample.temp", error));
+    QCOMPARE(expression.fields(), QStringList({"a", "Field name", "sample.temp"}));
+    QVERIFY(expression.parse("moving_avg(pressure, 1.5min) - 2e-3 * derivative(-pressure)", error));
+    QCOMPARE(expression.fields(), QStringList({"pressure"}));
+    QVERIFY(expression.parse("abs(sqrt(exp(log(((x))))))", error));
+    QCOMPARE(expression.fields(), QStringList({"x"}));
+}
+
+void TestLogExpression::parseErrors_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("error");
+
+    QTest::newRow("empty") << "" << "expression ends early";
+    QTest::newRow("trailing operator") << "a +" << "expression ends early";
+    QTest::newRow("unclosed bracket") << "(a - b" << "missing ')'";
+    QTest::newRow("unclosed call") << "abs(a" << "missing ')'";
+    QTest::newRow("unclosed quote") << "\"a - b" << "missing closing '\"'";
+    QTest::newRow("unknown function") << "foo(a)" << "unknown function 'foo'";
+    QTest::newRow("too many arguments") << "sqrt(a, b)" << "sqrt takes one value";
+    QTest::newRow("no arguments") << "derivative()" << "derivative takes one value";
+    QTest::newRow("window not constant") << "moving_avg(a, b)" << "moving_avg takes a value and a window";
+    QTest::newRow("window not positive") << "moving_avg(a, 0s)" << "moving_avg takes a value and a window";
+    QTest::newRow("unknown unit") << "a * 3days" << "unknown unit 'days'";
+    QTest::newRow("no fields") << "1 + 2" << "no fields are read";
+    QTest::newRow("unexpected text") << "a b" << "unexpected 'b'";
+    QTest::newRow("unexpected symbol") << "a * #" << "unexpected '#'";
+}
+
+void TestLogExpression::parseErrors()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, error);
+
+    LogExpression expression;
+    QString message;
+    QVERIFY(!expression.parse(text, message));
+    QVERIFY2(message.startsWith(error), qPrintable(message));
+    // Failed expressions evaluate to nothing
+    QCOMPARE(expression.evaluate({})->size(), 0);
+}
+
+void TestLogExpression::arithmetic()
+{
+    QHash<QString, QSharedPointer<SeriesBuffer>> fields = {
+        {"a", QSharedPointer<SeriesBuffer>::create(QVector<double>{0.0, 1.0, 2.0, 3.0},
+                                                   QVector<double>{1.0, 2.0, 3.0, 4.0})},
+        {"b", QSharedPointer<SeriesBuffer>::create(QVector<double>{0.0, 1.0, 2.0, 3.0},
+                                                   QVector<double>{4.0, 3.0, 2.0, 1.0})}};
+    QVector<double> x = {0.0, 1.0, 2.0, 3.0};
+    compare(evaluate("a - b", fields), x, {-3.0, -1.0, 1.0, 3.0});
+    if (QTest::currentTestFailed())
+        return;
+    // Products bind tighter than sums, and operators of equal precedence apply left to right
+    compare(evaluate("a + b * 2", fields), x, {9.0, 8.0, 7.0, 6.0});
+    if (QTest::currentTestFailed())
+        return;
+    compare(evaluate("a - b - 1", fields), x, {-4.0, -2.0, 0.0, 2.0});
+    if (QTest::currentTestFailed())
+        return;
+    compare(evaluate("-(a - b) / 2", fields), x, {1.5, 0.5, -0.5, -1.5});
+    if (QTest::currentTestFailed())
+        return;
+    compare(evaluate("a * 1min + 1.5e1 - -b", fields), x, {79.0, 138.0, 197.0, 256.0});
+}
+
+void TestLogExpression::functions()
+{
+    QHash<QString, QSharedPointer<SeriesBuffer>> fields = {
+        {"a", QSharedPointer<SeriesBuffer>::create(QVector<double>{0.0, 1.0, 2.0}, QVector<double>{-4.0, 1.0, 9.0})}};
+    QVector<double> x = {0.0, 1.0, 2.0};
+    compare(evaluate("abs(a)", fields), x, {4.0, 1.0, 9.0});
+    if (QTest::currentTestFailed())
+        return;
+    compare(evaluate("sqrt(abs(a))", fields), x, {2.0, 1.0, 3.0});
+    if (QTest::currentTestFailed())
+        return;
+    compare(evaluate("log(exp(a))", fields), x, {-4.0, 1.0, 9.0});
+}
+
+void TestLogExpression::derivative()
+{
+    // Central differences within, one sided at the ends, over uneven times
+    QHash<QString, QSharedPointer<SeriesBuffer>> fields = {
+        {"a", QSharedPointer<SeriesBuffer>::create(QVector<double>{0.0, 1.0, 2.0, 3.0, 5.0},
+                                                   QVector<double>{0.0, 1.0, 4.0, 9.0, 25.0})}};
+    compare(evaluate("derivative(a)", fields), {0.0, 1.0, 2.0, 3.0, 5.0}, {1.0, 2.0, 4.0, 7.0, 8.0});
+    if (QTest::currentTestFailed())
+        return;
+
+    // A single sample has no slope
+    fields["a"] = QSharedPointer<SeriesBuffer>::create(QVector<double>{1.0}, QVector<double>{3.0});
+    compare(evaluate("derivative(a)", fields), {1.0}, {0.0});
+}
+
+void TestLogExpression::movingAverage()
+{
+    // Half the window either side, so fewer samples are averaged at the ends
+    QHash<QString, QSharedPointer<SeriesBuffer>> fields = {
+        {"a", QSharedPointer<SeriesBuffer>::create(QVector<double>{0.0, 1.0, 2.0, 3.0, 4.0},
+                                                   QVector<double>{0.0, 1.0, 2.0, 3.0, 10.0})}};
+    QVector<double> x = {0.0, 1.0, 2.0, 3.0, 4.0};
+    compare(evaluate("moving_avg(a, 2s)", fields), x, {0.5, 1.0, 2.0, 5.0, 6.5});
+    if (QTest::currentTestFailed())
+        return;
+    // Windows narrower than the sample spacing leave values as they are
+    compare(evaluate("moving_avg(a, 0.5)", fields), x, {0.0, 1.0, 2.0, 3.0, 10.0});
+    if (QTest::currentTestFailed())
+        return;
+    compare(evaluate("moving_avg(a, 1h)", fields), x, {3.2, 3.2, 3.2, 3.2, 3.2});
+}
+
+void TestLogExpression::undefinedValues()
+{
+    // Non-finite results (log of negative values and zero, division by zero) are dropped
+    QHash<QString, QSharedPointer<SeriesBuffer>> fields = {
+        {"a", QSharedPointer<SeriesBuffer>::create(QVector<double>{0.0, 1.0, 2.0, 3.0},
+                                                   QVector<double>{1.0, 2.0, 3.0, 4.0})}};
+    compare(evaluate("log(a - 2)", fields), {2.0, 3.0}, {0.0, std::log(2.0)});
+    if (QTest::currentTestFailed())
+        return;
+    compare(evaluate("1 / (a - 3)", fields), {0.0, 1.0, 3.0}, {-0.5, -1.0, 1.0});
+}
+
+void TestLogExpression::differentTimes()
+{
+    // Fields are joined at every time either was recorded, over the span both cover, interpolating between samples
+    QHash<QString, QSharedPointer<SeriesBuffer>> fields = {
+        {"a", QSharedPointer<SeriesBuffer>::create(QVector<double>{0.0, 2.0, 4.0}, QVector<double>{0.0, 2.0, 4.0})},
+        {"b", QSharedPointer<SeriesBuffer>::create(QVector<double>{1.0, 3.0}, QVector<double>{10.0, 30.0})}};
+    compare(evaluate("a + b", fields), {1.0, 2.0, 3.0}, {11.0, 22.0, 33.0});
+    if (QTest::currentTestFailed())
+        return;
+
+    // Runs whose fields never overlap give nothing
+    fields["b"] = QSharedPointer<SeriesBuffer>::create(QVector<double>{5.0, 6.0}, QVector<double>{1.0, 1.0});
+    compare(evaluate("a + b", fields), {}, {});
+}
+
+void TestLogExpression::missingField()
+{
+    QHash<QString, QSharedPointer<SeriesBuffer>> fields = {
+        {"a", QSharedPointer<SeriesBuffer>::create(QVector<double>{0.0, 1.0}, QVector<double>{1.0, 2.0})}};
+    compare(evaluate("a - b", fields), {}, {});
+}
+
+QTEST_APPLESS_MAIN(TestLogExpression)
+#include "testlogexpression.moc"
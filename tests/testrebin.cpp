@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "rebin.h"
+#include <QtTest>
+#include <numeric>
+
+class TestRebin : public QObject
+{
+    Q_OBJECT
+
+    private:
+    void compare(const QVector<double> &actual, const QVector<double> &expected);
+
+    private slots:
+    void linearBoundaries();
+    void logarithmicBoundaries();
+    void sameBoundaries();
+    void splitAndMerge();
+    void unevenBins();
+    void outsideRange();
+    void conservesTotal();
+    void emptyInput();
+};
+
+void TestRebin::compare(const QVector<double> &actual, const QVector<double> &expected)
+{
+    QCOMPARE(actual.size(), expected.size());
+    for (auto i = 0; i < actual.size(); ++i)
+        QCOMPARE(actual[i], expected[i]);
+}
+
+void TestRebin::linearBoundaries()
+{
+    // The last bin is cut short at max
+    compare(Rebin::linear(0.0, 1.0, 0.3), {0.0, 0.3, 0.6, 0.9, 1.0});
+    if (QTest::currentTestFailed())
+        return;
+    compare(Rebin::linear(2.0, 4.0, 0.5), {2.0, 2.5, 3.0, 3.5, 4.0});
+    if (QTest::currentTestFailed())
+        return;
+    // (2.2 - 1.0) / 0.2 rounds to just above 6, which must not add a bin of no width
+    compare(Rebin::linear(1.0, 2.2, 0.2), {1.0, 1.2, 1.4, 1.6, 1.8, 2.0, 2.2});
+    QVERIFY(Rebin::linear(0.0, 1.0, 0.0).isEmpty());
+    QVERIFY(Rebin::linear(1.0, 1.0, 0.1).isEmpty());
+}
+
+void TestRebin::logarithmicBoundaries()
+{
+    compare(Rebin::logarithmic(1.0, 8.0, 1.0), {1.0, 2.0, 4.0, 8.0});
+    if (QTest::currentTestFailed())
+        return;
+    QVERIFY(Rebin::logarithmic(0.0, 8.0, 1.0).isEmpty());
+    QVERIFY(Rebin::logarithmic(1.0, 8.0, -0.5).isEmpty());
+}
+
+void TestRebin::sameBoundaries()
+{
+    QVector<double> boundaries = {0.0, 1.0, 2.0, 3.0, 4.0};
+    QVector<double> counts = {1.0, 2.0, 3.0, 4.0};
+    compare(Rebin::counts(boundaries, counts, boundaries), counts);
+}
+
+void TestRebin::splitAndMerge()
+{
+    // Counts are spread evenly across each original bin
+    QVector<double> boundaries = {0.0, 1.0, 2.0, 3.0, 4.0};
+    QVector<double> counts = {1.0, 2.0, 3.0, 4.0};
+    compare(Rebin::counts(boundaries, counts, {0.0, 0.5, 2.0, 4.0}), {0.5, 2.5, 7.0});
+    if (QTest::currentTestFailed())
+        return;
+    compare(Rebin::counts(boundaries, counts, {0.0, 0.25, 0.5, 0.75, 1.0}), {0.25, 0.25, 0.25, 0.25});
+    if (QTest::currentTestFailed())
+        return;
+    compare(Rebin::counts(boundaries, counts, {0.0, 4.0}), {10.0});
+}
+
+void TestRebin::unevenBins()
+{
+    compare(Rebin::counts({1.0, 2.0, 4.0, 8.0}, {2.0, 4.0, 8.0}, {1.0, 3.0, 8.0}), {4.0, 10.0});
+}
+
+void TestRebin::outsideRange()
+{
+    // New bins beyond the original range get nothing, and those straddling its ends only the part within it
+    QVector<double> boundaries = {0.0, 1.0, 2.0, 3.0, 4.0};
+    QVector<double> counts = {1.0, 2.0, 3.0, 4.0};
+    compare(Rebin::counts(boundaries, counts, {-2.0, -1.0, 0.0, 2.0, 5.0, 6.0}), {0.0, 0.0, 3.0, 7.0, 0.0});
+    if (QTest::currentTestFailed())
+        return;
+    compare(Rebin::counts(boundaries, counts, {-1.0, 0.5}), {0.5});
+    if (QTest::currentTestFailed())
+        return;
+    compare(Rebin::counts(boundaries, counts, {10.0, 11.0}), {0.0});
+}
+
+void TestRebin::conservesTotal()
+{
+    // Onto finer and coarser bins covering the original range, but for the empty start of its first bin
+    QVector<double> counts(1000);
+    for (auto i = 0; i < counts.size(); ++i)
+        counts[i] = (i * 37) % 101;
+    auto boundaries = Rebin::linear(0.0, 20000.0, 20.0);
+    QCOMPARE(boundaries.size(), counts.size() + 1);
+    auto total = std::accumulate(counts.begin(), counts.end(), 0.0);
+    for (auto fraction : {0.001, 0.01, 0.5})
+    {
+        auto rebinned = Rebin::counts(boundaries, counts, Rebin::logarithmic(1.0, 20000.0, fraction));
+        QCOMPARE(std::accumulate(rebinned.begin(), rebinned.end(), 0.0), total);
+    }
+}
+
+void TestRebin::emptyInput()
+{
+    compare(Rebin::counts({}, {}, {0.0, 1.0, 2.0}), {0.0, 0.0});
+    if (QTest::currentTestFailed())
+        return;
+    compare(Rebin::counts({0.0}, {1.0}, {0.0, 1.0}), {0.0});
+    if (QTest::currentTestFailed())
+        return;
+    QVERIFY(Rebin::counts({0.0, 1.0}, {1.0}, {0.5}).isEmpty());
+}
+
+QTEST_APPLESS_MAIN(TestRebin)
+#include "testrebin.moc"
@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (c) 2022 E. Devlin and T. Youngs
+
+#include "seriesbuffer.h"
+#include "seriescodec.h"
+#include <QtTest>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// Samples must come back bit for bit, so NaN payloads and signed zeros are compared as patterns
+static quint64 pattern(double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(double));
+    return bits;
+}
+
+static double fromPattern(quint64 bits)
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(double));
+    return value;
+}
+
+class TestSeriesCodec : public QObject
+{
+    Q_OBJECT
+
+    private:
+    // Encode samples as a block after another (so it starts part way through a word) and decode it alone
+    void roundTrip(const QVector<double> &x, const QVector<double> &y);
+
+    private slots:
+    void specialValues();
+    void negativeTimes();
+    void nonMonotonicTimes();
+    void constantSeries();
+    void blockSizes();
+    void wideXorWindows();
+    void bufferBlocks();
+};
+
+void TestSeriesCodec::roundTrip(const QVector<double> &x, const QVector<double> &y)
+{
+    QVector<quint64> words;
+    qint64 bitCount = 0;
+    const double leading[] = {0.5, 1.5, 2.5};
+    SeriesCodec::encode(leading, leading, 3, words, bitCount);
+    auto offset = SeriesCodec::encode(x.constData(), y.constData(), x.size(), words, bitCount);
+    QVERIFY(offset % 64 != 0);
+
+    QVector<double> decodedX(x.size());
+    QVector<double> decodedY(y.size());
+    SeriesCodec::decode(words, offset, x.size(), decodedX.data(), decodedY.data());
+    for (auto i = 0; i < x.size(); ++i)
+    {
+        QCOMPARE(pattern(decodedX[i]), pattern(x[i]));
+        QCOMPARE(pattern(decodedY[i]), pattern(y[i]));
+    }
+
+    // The block before is untouched by the one after
+    double leadingX[3];
+    double leadingY[3];
+    SeriesCodec::decode(words, 0, 3, leadingX, leadingY);
+    for (auto i = 0; i < 3; ++i)
+    {
+        QCOMPARE(leadingX[i], leading[i]);
+        QCOMPARE(leadingY[i], leading[i]);
+    }
+}
+
+void TestSeriesCodec::specialValues()
+{
+    QVector<double> y = {std::numeric_limits<double>::quiet_NaN(),
+                         -std::numeric_limits<double>::quiet_NaN(),
+                         fromPattern(0x7ff0000000000001),
+                         std::numeric_limits<double>::infinity(),
+                         -std::numeric_limits<double>::infinity(),
+                         0.0,
+                         -0.0,
+                         std::numeric_limits<double>::denorm_min(),
+                         std::numeric_limits<double>::min(),
+                         std::numeric_limits<double>::max(),
+                         std::numeric_limits<double>::lowest(),
+                         1.0,
+                         std::numeric_limits<double>::quiet_NaN()};
+    QVector<double> x(y.size());
+    for (auto i = 0; i < x.size(); ++i)
+        x[i] = i * 0.25;
+    roundTrip(x, y);
+    if (QTest::currentTestFailed())
+        return;
+    // Special values are as likely in times read from a damaged log
+    roundTrip(y, x);
+}
+
+void TestSeriesCodec::negativeTimes()
+{
+    // Entirely negative, and crossing zero, where the sign bit of the times' patterns flips
+    QVector<double> x;
+    QVector<double> y;
+    for (auto i = 0; i < 200; ++i)
+    {
+        x.append(-100.0 + i * 0.5);
+        y.append(std::sin(i * 0.1));
+    }
+    roundTrip(x, y);
+    if (QTest::currentTestFailed())
+        return;
+    roundTrip({-3.0, -2.0, -1.0, -0.0, 0.0, 1.0, 2.0, 3.0}, {1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0});
+}
+
+void TestSeriesCodec::nonMonotonicTimes()
+{
+    roundTrip({5.0, 3.0, 9.0, -2.0, 0.0, 1e10, 1e-10, 3.0, 3.0, -1e300, 1e300, 7.0},
+              {1.0, 1.0, 2.0, 2.0, 3.0, 3.0, 4.0, 4.0, 5.0, 5.0, 6.0, 6.0});
+    if (QTest::currentTestFailed())
+        return;
+
+    // Decreasing
+    QVector<double> x;
+    QVector<double> y;
+    for (auto i = 0; i < 100; ++i)
+    {
+        x.append(1000.0 - i * 3.0);
+        y.append(i);
+    }
+    roundTrip(x, y);
+}
+
+void TestSeriesCodec::constantSeries()
+{
+    // Constant values, at regular times and at a single repeated time, including all zero times
+    QVector<double> x(300);
+    QVector<double> y(300, 42.0);
+    for (auto i = 0; i < x.size(); ++i)
+        x[i] = 1.0e9 + i;
+    roundTrip(x, y);
+    if (QTest::currentTestFailed())
+        return;
+    roundTrip(QVector<double>(300, 17.5), y);
+    if (QTest::currentTestFailed())
+        return;
+    roundTrip(QVector<double>(300, 0.0), QVector<double>(300, 0.0));
+}
+
+void TestSeriesCodec::blockSizes()
+{
+    for (auto count : {1, 2, 255, 256, 257})
+    {
+        QVector<double> x(count);
+        QVector<double> y(count);
+        for (auto i = 0; i < count; ++i)
+        {
+            x[i] = 12.0 + i * 0.1 + (i % 7) * 1.0e-3;
+            y[i] = std::cos(i * 0.37) * 1.0e3;
+        }
+        roundTrip(x, y);
+        if (QTest::currentTestFailed())
+            return;
+    }
+}
+
+void TestSeriesCodec::wideXorWindows()
+{
+    // XORs using all 64 bits, ones fitting the previous window, and ones with more leading zeros than the 5-bit count
+    // can hold
+    QVector<quint64> patterns = {0x0000000000000000, 0x0000000000000003, 0x8000000000000001, 0x8000000000000003,
+                                 0x0000000000000001, 0xffffffffffffffff, 0x7fffffffffffffff, 0x7ffffffffffffffe,
+                                 0x0000000100000000, 0x0000000000000000, 0xfff0000000000000, 0x000fffffffffffff};
+    QVector<double> x;
+    QVector<double> y;
+    for (auto i = 0; i < patterns.size(); ++i)
+    {
+        x.append(i);
+        y.append(fromPattern(patterns[i]));
+    }
+    roundTrip(x, y);
+    if (QTest::currentTestFailed())
+        return;
+
+    // Time deltas needing the widest signed width
+    roundTrip({1.0e-300, 1.0e300, -1.0e-300, -1.0e300, 1.0e-300}, {1.0, 2.0, 3.0, 4.0, 5.0});
+}
+
+void TestSeriesCodec::bufferBlocks()
+{
+    // Buffers decode each 256 sample block alone, so a 257th sample is a block of one
+    for (auto count : {1, 256, 257, 513})
+    {
+        QVector<double> x(count);
+        QVector<double> y(count);
+        for (auto i = 0; i < count; ++i)
+        {
+            x[i] = -50.0 + i * 0.5;
+            y[i] = i == 100 ? std::numeric_limits<double>::quiet_NaN() : std::sin(i * 0.05);
+        }
+        SeriesBuffer buffer(x, y);
+        QCOMPARE(buffer.size(), count);
+        // Read the blocks out of order
+        for (auto i = count - 1; i >= 0; i -= 97)
+        {
+            QCOMPARE(pattern(buffer.x(i)), pattern(x[i]));
+            QCOMPARE(pattern(buffer.y(i)), pattern(y[i]));
+        }
+        auto restored = SeriesBuffer::fromBinary(buffer.toBinary());
+        QCOMPARE(restored->size(), count);
+        for (auto i = 0; i < count; ++i)
+        {
+            QCOMPARE(pattern(restored->x(i)), pattern(x[i]));
+            QCOMPARE(pattern(restored->y(i)), pattern(y[i]));
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(TestSeriesCodec)
+#include "testseriescodec.moc"